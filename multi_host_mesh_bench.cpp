@@ -0,0 +1,297 @@
+#include "multi_host_mesh_runtime.hpp"
+#include "multi_host_mesh_coordination.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+using namespace mesh;
+
+// Host-overhead benchmark: runs the lockstep host ops at scale and reports per-op latency
+// percentiles and throughput. Mesh shape, host submesh shape and world size are fixed
+// per run (one MeshDevice per process), so sweep them from the launcher; workload size,
+// batch size and validation mode are swept in-process.
+
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " <mesh_x> <mesh_y> <host_submesh_x> <host_submesh_y>"
+              << " [--words <n,...>] [--batch <n,...>] [--validate <mode,...>] [--iters <n>] [--dispatch-every <n>]"
+              << " [--dispatch-threads <n>] [--async-depth <n>] [--coord mpi|shm|tcp] [--csv on|off]\n"
+              << "  mesh_x, mesh_y, host_x, host_y: as for multi_host_mesh_example\n"
+              << "  --words <n,...>: Command words per workload to sweep (default: 1,64,1024)\n"
+              << "  --batch <n,...>: Workloads per MeshCQ::push to sweep (default: 1,16)\n"
+              << "  --validate <mode,...>: Validation modes to sweep, of on|off|deferred|nonblocking (default: on,off)\n"
+              << "  --iters <n>: Samples per op and sweep point (default: 1000)\n"
+              << "  --dispatch-every <n>: Pushes between dispatch_pending calls (default: 16)\n"
+              << "  --dispatch-threads <n>: Worker threads draining local DeviceCQs (default: 0, serial)\n"
+              << "  --async-depth <n>: Asynchronous MeshCQ; 'dispatch' then times MeshCQ::finish (default: 0)\n"
+              << "  --coord mpi|shm|tcp: Host coordination backend (default: mpi)\n"
+              << "  --csv on|off: Print comma-separated rows instead of a table (default: off)\n";
+    std::exit(1);
+}
+
+// Struct to hold parsed arguments
+struct BenchArgs {
+    Shape mesh_shape;
+    Shape host_submesh_shape;
+    std::vector<size_t> words = {1, 64, 1024};
+    std::vector<size_t> batch = {1, 16};
+    std::vector<std::string> validate = {"on", "off"};
+    size_t iters = 1000;
+    size_t dispatch_every = 16;
+    mesh::DispatchConfig dispatch;
+    std::string coord = "mpi";
+    bool csv = false;
+};
+
+std::vector<size_t> parse_list(const std::string& flag, const std::string& value, const char* prog) {
+    std::vector<size_t> out;
+    std::stringstream in(value);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        long long n = std::atoll(item.c_str());
+        if (n <= 0) {
+            std::cerr << "Error: Invalid value '" << item << "' for " << flag << " flag. Must be positive.\n";
+            usage(prog);
+        }
+        out.push_back(size_t(n));
+    }
+    if (out.empty()) usage(prog);
+    return out;
+}
+
+BenchArgs parse_args(int argc, char** argv) {
+    BenchArgs args;
+    if (argc < 5) usage(argv[0]); // Need at least 4 shape args
+
+    args.mesh_shape = {
+        static_cast<uint32_t>(std::atoi(argv[1])),
+        static_cast<uint32_t>(std::atoi(argv[2]))
+    };
+    args.host_submesh_shape = {
+        static_cast<uint32_t>(std::atoi(argv[3])),
+        static_cast<uint32_t>(std::atoi(argv[4]))
+    };
+    int current_arg = 5;
+
+    while (current_arg < argc) {
+        std::string flag = argv[current_arg++];
+        if (current_arg >= argc) { // Each flag needs a value
+            std::cerr << "Error: Flag '" << flag << "' requires an argument.\n";
+            usage(argv[0]);
+        }
+        std::string value = argv[current_arg++];
+
+        if (flag == "--words") {
+            args.words = parse_list(flag, value, argv[0]);
+        } else if (flag == "--batch") {
+            args.batch = parse_list(flag, value, argv[0]);
+        } else if (flag == "--validate") {
+            args.validate.clear();
+            std::stringstream in(value);
+            std::string mode;
+            while (std::getline(in, mode, ',')) {
+                if (mode != "on" && mode != "off" && mode != "deferred" && mode != "nonblocking") {
+                    std::cerr << "Error: Invalid value '" << mode << "' for --validate flag. Use 'on', 'off', 'deferred' or 'nonblocking'.\n";
+                    usage(argv[0]);
+                }
+                args.validate.push_back(mode);
+            }
+            if (args.validate.empty()) usage(argv[0]);
+        } else if (flag == "--iters") {
+            args.iters = parse_list(flag, value, argv[0]).front();
+        } else if (flag == "--dispatch-every") {
+            args.dispatch_every = parse_list(flag, value, argv[0]).front();
+        } else if (flag == "--dispatch-threads") {
+            int threads = std::atoi(value.c_str());
+            if (threads < 0) {
+                std::cerr << "Error: Invalid value for --dispatch-threads flag. Must be non-negative.\n";
+                usage(argv[0]);
+            }
+            args.dispatch.threads = static_cast<size_t>(threads);
+        } else if (flag == "--async-depth") {
+            int depth = std::atoi(value.c_str());
+            if (depth < 0) {
+                std::cerr << "Error: Invalid value for --async-depth flag. Must be non-negative.\n";
+                usage(argv[0]);
+            }
+            args.dispatch.async_depth = static_cast<size_t>(depth);
+        } else if (flag == "--coord") {
+            if (value != "mpi" && value != "shm" && value != "tcp") {
+                std::cerr << "Error: Invalid value for --coord flag. Use 'mpi', 'shm' or 'tcp'.\n";
+                usage(argv[0]);
+            }
+            args.coord = value;
+        } else if (flag == "--csv") {
+            if (value != "on" && value != "off") {
+                std::cerr << "Error: Invalid value for --csv flag. Use 'on' or 'off'.\n";
+                usage(argv[0]);
+            }
+            args.csv = value == "on";
+        } else {
+            std::cerr << "Error: Unknown optional argument '" << flag << "'\n";
+            usage(argv[0]);
+        }
+    }
+    return args;
+}
+
+// Latency samples of one op at one sweep point, in nanoseconds
+class Samples {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    void add(Clock::time_point start) {
+        ns_.push_back(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()));
+    }
+    size_t size() const { return ns_.size(); }
+
+    // Collective: sorts this rank's samples, then takes each statistic from the slowest
+    // rank, since lockstep ops advance at the pace of the last host to get there.
+    // out: p50, p90, p99, max, total
+    void reduce(uint64_t out[5]) {
+        std::sort(ns_.begin(), ns_.end());
+        uint64_t total = 0;
+        for (uint64_t v : ns_) total += v;
+        uint64_t in[5] = { ~at(0.50), ~at(0.90), ~at(0.99), ~at(1.0), ~total };
+        HostCoordinator::get().allreduce_min(in, out, 5); // Max as ~min(~v)
+        for (int i = 0; i < 5; ++i) out[i] = ~out[i];
+        ns_.clear();
+    }
+
+private:
+    uint64_t at(double q) const {
+        if (ns_.empty()) return 0;
+        return ns_[std::min(ns_.size() - 1, size_t(q * double(ns_.size() - 1) + 0.5))];
+    }
+    std::vector<uint64_t> ns_;
+};
+
+class Report {
+public:
+    Report(int rank, bool csv) : rank_(rank), csv_(csv) {}
+
+    void header(const BenchArgs& args, int world) const {
+        if (rank_ != 0) return;
+        if (csv_) {
+            std::cout << "op,validate,words,batch,samples,p50_us,p90_us,p99_us,max_us,ops_per_s,workloads_per_s,words_per_s\n";
+            return;
+        }
+        std::cout << "mesh " << to_string(args.mesh_shape) << ", host submesh " << to_string(args.host_submesh_shape)
+                  << ", " << world << " rank(s), dispatch threads " << args.dispatch.threads
+                  << ", async depth " << args.dispatch.async_depth << "\n";
+        std::printf("%-10s %-12s %6s %6s %8s %10s %10s %10s %10s %12s %12s %12s\n", "op", "validate", "words", "batch",
+                    "samples", "p50_us", "p90_us", "p99_us", "max_us", "ops/s", "workloads/s", "words/s");
+    }
+
+    // Collective. `workloads` and `words`: totals over this rank's samples (0 = not applicable).
+    void row(const char* op, const std::string& validate, size_t words_per, size_t batch, Samples& s,
+             size_t workloads, size_t words) const {
+        const size_t n = s.size();
+        uint64_t st[5];
+        s.reduce(st);
+        if (rank_ != 0) return;
+        const double secs = double(st[4]) * 1e-9;
+        const double ops = rate(n, secs);
+        if (csv_) {
+            std::printf("%s,%s,%zu,%zu,%zu,%.3f,%.3f,%.3f,%.3f,%.1f,%.1f,%.1f\n", op, validate.c_str(), words_per, batch, n,
+                        st[0] * 1e-3, st[1] * 1e-3, st[2] * 1e-3, st[3] * 1e-3, ops, rate(workloads, secs), rate(words, secs));
+        } else {
+            std::printf("%-10s %-12s %6zu %6zu %8zu %10.2f %10.2f %10.2f %10.2f %12.0f %12.0f %12.0f\n", op,
+                        validate.c_str(), words_per, batch, n, st[0] * 1e-3, st[1] * 1e-3, st[2] * 1e-3, st[3] * 1e-3,
+                        ops, rate(workloads, secs), rate(words, secs));
+        }
+        std::fflush(stdout);
+    }
+
+private:
+    static double rate(size_t count, double secs) { return secs > 0 ? double(count) / secs : 0; }
+
+    int  rank_;
+    bool csv_;
+};
+
+void set_validation(const std::string& mode) {
+    Validation::enabled(mode != "off");
+    if (mode == "deferred") Validation::defer(0);
+    else if (mode == "nonblocking") Validation::nonblocking();
+    else Validation::immediate();
+}
+
+// `words` command words for every device, the last one a runtime argument so repeated
+// pushes exercise the program cache's patch path instead of re-encoding.
+MeshWorkload make_workload(Shape mesh_shape, size_t words) {
+    MeshWorkload::Builder b(mesh_shape);
+    for (size_t i = 0; i + 1 < words; ++i) b.add(0xBE4C000000000000ULL | i);
+    b.add_arg(0);
+    return b.build();
+}
+
+int main(int argc, char** argv) {
+    BenchArgs args = parse_args(argc, argv);
+    if (args.coord != "mpi") HostCoordinator::use(make_coordinator(args.coord)); // Before open
+
+    auto& dev = MeshDevice::open(args.mesh_shape, args.host_submesh_shape, true, Debug::Mode::NONE, -1, args.dispatch);
+    auto& cq  = dev.cq();
+    const Shape mesh_shape = dev.mesh_shape();
+    Report report(dev.rank(), args.csv);
+    report.header(args, HostCoordinator::get().size());
+    Samples s;
+    Samples::Clock::time_point t0;
+
+    for (const auto& mode : args.validate) {
+        set_validation(mode);
+
+        // MeshBuffer allocation (lockstep check included); deallocated untimed
+        for (size_t i = 0; i < args.iters; ++i) {
+            t0 = Samples::Clock::now();
+            MeshBuffer buf = dev.allocate({256, 256});
+            s.add(t0);
+            dev.deallocate(buf);
+        }
+        report.row("allocate", mode, 0, 0, s, 0, 0);
+
+        for (size_t words : args.words) {
+            // MeshWorkload construction: Builder appends plus the lockstep check
+            const size_t max_batch = *std::max_element(args.batch.begin(), args.batch.end());
+            std::vector<MeshWorkload> pool;
+            for (size_t i = 0; i < args.iters; ++i) {
+                t0 = Samples::Clock::now();
+                MeshWorkload wl = make_workload(mesh_shape, words);
+                s.add(t0);
+                if (pool.size() < max_batch) pool.push_back(wl);
+            }
+            report.row("build", mode, words, 1, s, args.iters, args.iters * words);
+            while (pool.size() < max_batch) pool.push_back(pool.front());
+
+            for (size_t b : args.batch) {
+                Samples dispatch;
+                uint64_t arg = 0;
+                for (size_t i = 0; i < args.iters; ++i) {
+                    for (size_t k = 0; k < b; ++k) pool[k].set_arg(0, ++arg); // Untimed: changes every push
+                    t0 = Samples::Clock::now();
+                    cq.push(pool.data(), b);
+                    s.add(t0);
+                    if ((i + 1) % args.dispatch_every == 0 || i + 1 == args.iters) {
+                        t0 = Samples::Clock::now();
+                        if (cq.async()) cq.finish();
+                        else            dev.dispatch_pending();
+                        dispatch.add(t0);
+                    }
+                }
+                report.row("push", mode, words, b, s, args.iters * b, args.iters * b * words);
+                report.row("dispatch", mode, words, b, dispatch, args.iters * b, args.iters * b * words);
+                dev.wait(); // Settles deferred and nonblocking checks of this point
+            }
+        }
+
+        // Global checkpoint: barrier plus whatever validation the mode defers to it
+        for (size_t i = 0; i < args.iters; ++i) {
+            t0 = Samples::Clock::now();
+            dev.wait();
+            s.add(t0);
+        }
+        report.row("wait", mode, 0, 0, s, 0, 0);
+    }
+
+    MeshDevice::close();
+    return 0;
+}
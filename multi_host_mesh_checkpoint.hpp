@@ -0,0 +1,223 @@
+#pragma once
+#include "multi_host_mesh_runtime.hpp"
+#include <cstdio>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+namespace mesh {
+
+// Checkpoint file: a fixed header, an index of tensors, then each tensor's elements
+// row-major at a page-aligned offset. Tensors are stored whole (not pre-split), so any
+// mesh / host submesh / BufferSpec can load the same file: every rank derives the byte
+// ranges it owns from MeshBuffer::host_region() and touches only those.
+//
+//   CheckpointHeader | CheckpointEntry[count] | pad | tensor 0 | pad | tensor 1 ...
+struct CheckpointHeader {
+    char     magic[8];   // "MHMCKPT1"
+    uint64_t count;
+};
+
+struct CheckpointEntry {
+    char     name[64];   // NUL-terminated
+    uint32_t dtype;      // DataType
+    uint32_t x, y;       // Shape (columns, rows)
+    uint32_t reserved;
+    uint64_t offset;     // Of element [0, 0] from the start of the file
+};
+
+struct CheckpointTensor {
+    std::string name;
+    DataType    dtype;
+    Shape       shape;
+    const void* data;    // Whole tensor, row-major
+};
+
+// Streaming knobs for Checkpoint::load
+struct CheckpointLoadConfig {
+    size_t band_bytes = 8u << 20; // Rank-local bytes per enqueue_write (rounded to whole rows)
+    size_t read_ahead = 2;        // Bands the kernel is asked to prefetch ahead of the copy
+};
+
+// Read-only mapping of a checkpoint file, shared by every load from it. Must outlive the
+// events returned by load().
+class Checkpoint {
+public:
+    enum { kPage = 4096 };
+
+    // Serial writer, e.g. run on one rank (or offline); tensors keep their order.
+    static bool save(const std::string& path, const std::vector<CheckpointTensor>& tensors) {
+        std::FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f) return false;
+        CheckpointHeader h;
+        std::memcpy(h.magic, "MHMCKPT1", 8);
+        h.count = tensors.size();
+        std::vector<CheckpointEntry> index(tensors.size());
+        uint64_t off = align(sizeof(h) + index.size() * sizeof(CheckpointEntry));
+        for (size_t i = 0; i < tensors.size(); ++i) {
+            CheckpointEntry& e = index[i];
+            std::memset(&e, 0, sizeof(e));
+            std::strncpy(e.name, tensors[i].name.c_str(), sizeof(e.name) - 1);
+            e.dtype  = uint32_t(tensors[i].dtype);
+            e.x      = tensors[i].shape.x;
+            e.y      = tensors[i].shape.y;
+            e.offset = off;
+            off = align(off + tensor_bytes(e));
+        }
+        bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1 &&
+                  (index.empty() || std::fwrite(index.data(), sizeof(CheckpointEntry), index.size(), f) == index.size());
+        for (size_t i = 0; ok && i < tensors.size(); ++i) {
+            ok = std::fseek(f, long(index[i].offset), SEEK_SET) == 0 &&
+                 std::fwrite(tensors[i].data, 1, tensor_bytes(index[i]), f) == tensor_bytes(index[i]);
+        }
+        return std::fclose(f) == 0 && ok;
+    }
+
+    explicit Checkpoint(const std::string& path) : path_(path), base_(nullptr), bytes_(0) {
+#if defined(__unix__) || defined(__APPLE__)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) fail("cannot open");
+        bytes_ = size_t(st.st_size);
+        void* p = bytes_ ? mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (p == MAP_FAILED) fail("cannot map");
+        base_ = static_cast<const uint8_t*>(p);
+#else
+        std::FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) fail("cannot open");
+        std::fseek(f, 0, SEEK_END);
+        copy_.resize(size_t(std::ftell(f)));
+        std::fseek(f, 0, SEEK_SET);
+        bytes_ = std::fread(copy_.data(), 1, copy_.size(), f);
+        std::fclose(f);
+        base_ = copy_.data();
+#endif
+        const CheckpointHeader* h = reinterpret_cast<const CheckpointHeader*>(base_);
+        // Bounds are checked without forming sums or products a corrupt header could overflow
+        if (bytes_ < sizeof(*h) || std::memcmp(h->magic, "MHMCKPT1", 8) != 0 ||
+            h->count > (bytes_ - sizeof(*h)) / sizeof(CheckpointEntry)) fail("not a checkpoint");
+        const CheckpointEntry* e = reinterpret_cast<const CheckpointEntry*>(h + 1);
+        for (uint64_t i = 0; i < h->count; ++i) {
+            if (e[i].offset > bytes_ || !fits(e[i], bytes_ - e[i].offset)) fail("truncated");
+            if (std::memchr(e[i].name, 0, sizeof(e[i].name)) == nullptr) fail("unterminated tensor name");
+            index_[std::string(e[i].name)] = &e[i];
+        }
+    }
+    ~Checkpoint() {
+#if defined(__unix__) || defined(__APPLE__)
+        if (base_) munmap(const_cast<uint8_t*>(base_), bytes_);
+#endif
+    }
+    Checkpoint(const Checkpoint&) = delete;
+    Checkpoint& operator=(const Checkpoint&) = delete;
+
+    const CheckpointEntry* find(const std::string& name) const {
+        auto it = index_.find(name);
+        return it == index_.end() ? nullptr : it->second;
+    }
+
+    // Stream this rank's region of tensor `name` into `buf` (shape and dtype must match).
+    // The region is cut into bands of whole rows; each band is one zero-copy enqueue_write
+    // straight from the mapping while the kernel is asked to read the next `read_ahead`
+    // bands, so disk reads overlap the device copies. At most read_ahead + 1 bands are in
+    // flight: load waits for each band's own event before queueing past it. On a sync
+    // MeshCQ that wait dispatches the queue up to the band, i.e. also work queued before
+    // load. Only the owned byte ranges of each row are touched. Must be called in lockstep
+    // on all ranks (validated like allocate). Returns the event of the last band.
+    MeshEvent load(MeshDevice& dev, const MeshBuffer& buf, const std::string& name,
+                   const CheckpointLoadConfig& cfg = CheckpointLoadConfig()) const {
+        const CheckpointEntry* e = find(name);
+        if (!e) fail(("no tensor '" + name + "'").c_str());
+        if (e->x != buf.shape().x || e->y != buf.shape().y || DataType(e->dtype) != buf.dtype()) {
+            fail(("tensor '" + name + "' does not match the MeshBuffer").c_str());
+        }
+        if (buf.spec().layout != HostLayout::ROW_MAJOR) {
+            fail(("tensor '" + name + "' is stored row-major; the MeshBuffer is tilized").c_str());
+        }
+        if (Validation::on()) {
+            uint64_t crc = mix64(buf.address() ^ (uint64_t(e->dtype) << 56));
+            for (char c : name) crc = mix64(crc ^ uint8_t(c));
+            crc ^= mix64(e->offset) ^ e->x ^ (uint64_t(e->y) << 32);
+            Validation::check(crc, "Checkpoint load");
+        }
+
+        const TensorRegion& r = buf.host_region();
+        MeshEvent last;
+        std::deque<MeshEvent> in_flight;
+        if (r.empty()) return last;
+        const size_t es    = element_size(buf.dtype());
+        const size_t pitch = size_t(e->x) * es;
+        const size_t owned = r.width() * es; // Contiguous bytes per row this rank reads
+        const uint32_t band = uint32_t(std::max<size_t>(1, std::min<size_t>(cfg.band_bytes / owned, r.height())));
+        const uint8_t* origin = base_ + e->offset + r.y_range.start * pitch + r.x_range.start * es;
+
+        for (uint32_t y = r.y_range.start; y < r.y_range.end; y += band) {
+            for (size_t k = 1; k <= cfg.read_ahead; ++k) {
+                uint64_t ahead = y + uint64_t(k) * band;
+                if (ahead < r.y_range.end) prefetch(origin, pitch, owned, uint32_t(ahead - r.y_range.start),
+                                                    std::min<uint32_t>(band, r.y_range.end - uint32_t(ahead)));
+            }
+            if (y == r.y_range.start) prefetch(origin, pitch, owned, 0, band);
+            TensorRegion part = { r.x_range, Range(y, std::min(y + band, r.y_range.end)) };
+            last = dev.cq().enqueue_write(buf, origin + (y - r.y_range.start) * pitch, part, pitch);
+            in_flight.push_back(last);
+            if (in_flight.size() > cfg.read_ahead) {
+                dev.wait(in_flight.front()); // Local only; sync mode: dispatches up to this band
+                in_flight.pop_front();
+            }
+        }
+        if (Debug::should_print(dev.rank())) {
+            std::cout << "[rank " << dev.rank() << "] Checkpoint::load '" << name << "': "
+                      << r.elements() * es << " byte(s) of " << tensor_bytes(*e) << " in bands of " << band << " row(s)\n";
+        }
+        return last;
+    }
+
+private:
+    static uint64_t align(uint64_t v) { return (v + kPage - 1) / kPage * kPage; }
+    static size_t tensor_bytes(const CheckpointEntry& e) {
+        return size_t(e.x) * e.y * element_size(DataType(e.dtype));
+    }
+    // tensor_bytes(e) <= room, without overflowing for any x, y
+    static bool fits(const CheckpointEntry& e, uint64_t room) {
+        const uint64_t es = element_size(DataType(e.dtype));
+        return e.x == 0 || e.y == 0 || (uint64_t(e.x) <= room / es && uint64_t(e.y) <= room / es / e.x);
+    }
+    void fail(const char* what) const {
+        std::cerr << "Error: checkpoint " << path_ << ": " << what << "\n";
+        HostCoordinator::get().abort(1);
+    }
+
+    // Ask for rows [first, first + rows) of the owned columns without blocking. Narrow
+    // rows are advised one by one so unowned columns of wide tensors are not read.
+    void prefetch(const uint8_t* origin, size_t pitch, size_t owned, uint32_t first, uint32_t rows) const {
+#if defined(MADV_WILLNEED)
+        const uint8_t* start = origin + size_t(first) * pitch;
+        if (owned * 2 >= pitch || rows == 1) {
+            advise(start, size_t(rows - 1) * pitch + owned);
+        } else {
+            for (uint32_t i = 0; i < rows; ++i) advise(start + size_t(i) * pitch, owned);
+        }
+#else
+        (void)origin; (void)pitch; (void)owned; (void)first; (void)rows;
+#endif
+    }
+    void advise(const uint8_t* p, size_t n) const {
+#if defined(MADV_WILLNEED)
+        uintptr_t a = reinterpret_cast<uintptr_t>(p) & ~uintptr_t(kPage - 1);
+        madvise(reinterpret_cast<void*>(a), n + (reinterpret_cast<uintptr_t>(p) - a), MADV_WILLNEED);
+#else
+        (void)p; (void)n;
+#endif
+    }
+
+    std::string path_;
+    const uint8_t* base_;
+    size_t bytes_;
+    std::vector<uint8_t> copy_; // No mmap: whole file read up front
+    std::map<std::string, const CheckpointEntry*> index_;
+};
+
+} // namespace mesh
@@ -0,0 +1,298 @@
+#pragma once
+#include "multi_host_mesh_runtime.hpp"
+#include <cstdio>
+#include <cerrno>
+#include <chrono>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+namespace mesh {
+
+#if defined(__unix__) || defined(__APPLE__)
+
+// Before an abort takes the peers down: let ranks that detected the same failure
+// (e.g. rank 0 reporting a divergence) finish writing their diagnostics
+inline void grace() {
+    std::cerr.flush();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+
+// Ranks that share one physical host, coordinated through a POSIX shared-memory segment.
+// Barriers are pairwise flags (one counter per ordered rank pair), so a scoped barrier
+// only involves its participants and no call enters the kernel; allreduce stages each
+// rank's words in its own slot between two barriers. `name` must be unique per job
+// (e.g. derived from the job id); rank 0 unlinks it as soon as every rank is attached,
+// so even an aborted job leaves nothing behind.
+class ShmCoordinator : public HostCoordinator {
+public:
+    enum { kMaxRanks = 64, kSlotWords = 512 };
+
+    ShmCoordinator(const std::string& name, int rank, int size) : name_(name), rank_(rank), size_(size) {
+        if (size < 1 || size > kMaxRanks || rank < 0 || rank >= size) die("bad rank/size");
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+        if (fd < 0 || ftruncate(fd, sizeof(Shared)) != 0) die("cannot create segment");
+        void* p = mmap(nullptr, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) die("cannot map segment");
+        shm_ = static_cast<Shared*>(p); // Zero-filled by ftruncate: atomics start at 0
+        sent_.assign(size_, 0);
+        shm_->attached.fetch_add(1);
+        spin([this] { return shm_->attached.load() >= uint32_t(size_); });
+        if (rank_ == 0) shm_unlink(name.c_str());
+    }
+    ~ShmCoordinator() { if (shm_) munmap(shm_, sizeof(Shared)); }
+
+    const char* name() const override { return "shm"; }
+    int  rank() const override { return rank_; }
+    int  size() const override { return size_; }
+    void barrier() override { barrier(all()); }
+    void barrier(const std::vector<int>& ranks) override {
+        for (int j : ranks) if (j != rank_) shm_->flag[rank_][j].store(++sent_[j], std::memory_order_release);
+        for (int j : ranks) {
+            if (j == rank_) continue;
+            const uint64_t want = sent_[j];
+            std::atomic<uint64_t>& f = shm_->flag[j][rank_];
+            spin([&f, want] { return f.load(std::memory_order_acquire) >= want; });
+        }
+    }
+    void allreduce_min(const uint64_t* in, uint64_t* out, size_t n) override { allreduce_min(all(), in, out, n); }
+    void allreduce_min(const std::vector<int>& ranks, const uint64_t* in, uint64_t* out, size_t n) override {
+        for (size_t off = 0; off < n; off += kSlotWords) {
+            size_t k = std::min<size_t>(kSlotWords, n - off);
+            std::memcpy(shm_->slot[rank_], in + off, k * sizeof(uint64_t));
+            barrier(ranks);
+            for (size_t i = 0; i < k; ++i) {
+                uint64_t m = in[off + i];
+                for (int r : ranks) m = std::min(m, shm_->slot[r][i]);
+                out[off + i] = m;
+            }
+            barrier(ranks); // Slots are reused by the next chunk / call
+        }
+    }
+    std::vector<int> node_ranks() override { return all(); }
+    void abort(int code) override {
+        grace();
+        shm_->aborted.store(code ? code : 1);
+        std::_Exit(code);
+    }
+
+private:
+    struct Shared {
+        std::atomic<uint32_t> attached;
+        std::atomic<int>      aborted;
+        std::atomic<uint64_t> flag[kMaxRanks][kMaxRanks]; // [from][to]: barriers signalled
+        uint64_t              slot[kMaxRanks][kSlotWords];
+    };
+    std::vector<int> all() const { std::vector<int> r(size_); for (int i = 0; i < size_; ++i) r[i] = i; return r; }
+    template <class Pred> void spin(Pred done) {
+        for (uint32_t i = 0; !done(); ++i) {
+            if (int code = shm_->aborted.load()) std::_Exit(code); // A peer aborted
+            if (i > 1024) std::this_thread::yield();
+        }
+    }
+    void die(const char* what) {
+        std::cerr << "Error: shm coordinator " << name_ << ": " << what << "\n";
+        std::_Exit(1);
+    }
+
+    std::string name_;
+    int rank_, size_;
+    Shared* shm_ = nullptr;
+    std::vector<uint64_t> sent_; // Barriers signalled to each peer (mirrors flag[rank_][*])
+};
+
+// Ranks on different hosts over plain TCP: a full mesh of connections with Nagle off,
+// rank r listening on hosts[r]:base_port + r. Barrier and allreduce exchange one message
+// with every participant, sent and received concurrently through poll(). A peer that
+// disappears (or aborts) ends every rank.
+class TcpCoordinator : public HostCoordinator {
+public:
+    TcpCoordinator(int rank, const std::vector<std::string>& hosts, uint16_t base_port)
+        : rank_(rank), size_(int(hosts.size())), hosts_(hosts), fds_(hosts.size(), -1)
+    {
+        if (rank < 0 || rank >= size_) die("bad rank");
+        int listener = -1;
+        if (rank_ + 1 < size_) listener = listen_on(uint16_t(base_port + rank_));
+        for (int j = 0; j < rank_; ++j) {
+            fds_[j] = connect_to(hosts[j], uint16_t(base_port + j));
+            int32_t me = rank_;
+            send_all(fds_[j], &me, sizeof(me));
+        }
+        for (int k = rank_ + 1; k < size_; ++k) {
+            int fd = ::accept(listener, nullptr, nullptr);
+            int32_t peer = -1;
+            if (fd < 0) die("accept failed");
+            recv_all(fd, &peer, sizeof(peer));
+            if (peer <= rank_ || peer >= size_ || fds_[peer] >= 0) die("unexpected peer");
+            fds_[peer] = fd;
+        }
+        if (listener >= 0) ::close(listener);
+        for (int fd : fds_) {
+            if (fd < 0) continue;
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+    }
+    ~TcpCoordinator() { for (int fd : fds_) if (fd >= 0) ::close(fd); }
+
+    const char* name() const override { return "tcp"; }
+    int  rank() const override { return rank_; }
+    int  size() const override { return size_; }
+    void barrier() override { barrier(all()); }
+    void barrier(const std::vector<int>& ranks) override {
+        uint64_t token = 0;
+        std::vector<uint64_t> in;
+        exchange(ranks, &token, 1, in);
+    }
+    void allreduce_min(const uint64_t* in, uint64_t* out, size_t n) override { allreduce_min(all(), in, out, n); }
+    void allreduce_min(const std::vector<int>& ranks, const uint64_t* in, uint64_t* out, size_t n) override {
+        std::vector<uint64_t> peers;
+        exchange(ranks, in, n, peers);
+        std::memcpy(out, in, n * sizeof(uint64_t));
+        for (size_t p = 0; p + 1 < ranks.size(); ++p)
+            for (size_t i = 0; i < n; ++i) out[i] = std::min(out[i], peers[p * n + i]);
+    }
+    std::vector<int> node_ranks() override {
+        std::vector<int> r;
+        for (int i = 0; i < size_; ++i) if (hosts_[i] == hosts_[rank_]) r.push_back(i);
+        return r;
+    }
+    void abort(int code) override {
+        grace();
+        for (int fd : fds_) if (fd >= 0) ::close(fd); // Peers see EOF and exit too
+        std::_Exit(code);
+    }
+
+private:
+    std::vector<int> all() const { std::vector<int> r(size_); for (int i = 0; i < size_; ++i) r[i] = i; return r; }
+
+    // Send `n` words to every other participant and receive n words from each into
+    // `in` (participant order, self skipped), all at once so large messages cannot deadlock.
+    void exchange(const std::vector<int>& ranks, const uint64_t* out, size_t n, std::vector<uint64_t>& in) {
+        const size_t bytes = n * sizeof(uint64_t);
+        std::vector<int> peers;
+        for (int j : ranks) if (j != rank_) peers.push_back(j);
+        in.assign(peers.size() * n, 0);
+        std::vector<size_t> sent(peers.size(), 0), got(peers.size(), 0);
+        std::vector<pollfd> pfds(peers.size());
+        for (size_t left = 2 * peers.size() * (bytes ? 1 : 0); left > 0;) {
+            for (size_t p = 0; p < peers.size(); ++p) {
+                pfds[p].fd = fds_[peers[p]];
+                pfds[p].events = short((sent[p] < bytes ? POLLOUT : 0) | (got[p] < bytes ? POLLIN : 0));
+                pfds[p].revents = 0;
+            }
+            if (::poll(pfds.data(), pfds.size(), -1) < 0) { if (errno == EINTR) continue; die("poll failed"); }
+            for (size_t p = 0; p < peers.size(); ++p) {
+                if ((pfds[p].revents & POLLOUT) && sent[p] < bytes) {
+                    ssize_t w = ::send(pfds[p].fd, reinterpret_cast<const char*>(out) + sent[p], bytes - sent[p], kSendFlags);
+                    if (w < 0 && errno != EAGAIN && errno != EINTR) die("peer lost");
+                    if (w > 0 && (sent[p] += size_t(w)) == bytes) --left;
+                }
+                if ((pfds[p].revents & (POLLIN | POLLHUP | POLLERR)) && got[p] < bytes) {
+                    ssize_t r = ::recv(pfds[p].fd, reinterpret_cast<char*>(&in[p * n]) + got[p], bytes - got[p], MSG_DONTWAIT);
+                    if (r == 0 || (r < 0 && errno != EAGAIN && errno != EINTR)) die("peer lost");
+                    if (r > 0 && (got[p] += size_t(r)) == bytes) --left;
+                }
+            }
+        }
+    }
+
+    int listen_on(uint16_t port) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in a;
+        std::memset(&a, 0, sizeof(a));
+        a.sin_family = AF_INET;
+        a.sin_addr.s_addr = htonl(INADDR_ANY);
+        a.sin_port = htons(port);
+        if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&a), sizeof(a)) != 0 || ::listen(fd, size_) != 0) {
+            die("cannot listen");
+        }
+        return fd;
+    }
+    int connect_to(const std::string& host, uint16_t port) {
+        addrinfo hints, *res = nullptr;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0 || !res) die("cannot resolve peer");
+        for (int attempt = 0; attempt < 3000; ++attempt) { // The peer may not be listening yet
+            int fd = ::socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+            if (fd >= 0 && ::connect(fd, res->ai_addr, res->ai_addrlen) == 0) { freeaddrinfo(res); return fd; }
+            if (fd >= 0) ::close(fd);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        freeaddrinfo(res);
+        die("cannot connect to peer");
+        return -1;
+    }
+    void send_all(int fd, const void* p, size_t n) {
+        for (size_t off = 0; off < n;) {
+            ssize_t w = ::send(fd, static_cast<const char*>(p) + off, n - off, kSendFlags & ~MSG_DONTWAIT);
+            if (w <= 0) die("send failed");
+            off += size_t(w);
+        }
+    }
+    void recv_all(int fd, void* p, size_t n) {
+        for (size_t off = 0; off < n;) {
+            ssize_t r = ::recv(fd, static_cast<char*>(p) + off, n - off, 0);
+            if (r <= 0) die("peer lost");
+            off += size_t(r);
+        }
+    }
+    void die(const char* what) {
+        std::cerr << "Error: tcp coordinator rank " << rank_ << ": " << what << "\n";
+        std::_Exit(1);
+    }
+
+#if defined(MSG_NOSIGNAL)
+    static const int kSendFlags = MSG_DONTWAIT | MSG_NOSIGNAL; // EPIPE instead of SIGPIPE
+#else
+    static const int kSendFlags = MSG_DONTWAIT;
+#endif
+    int rank_, size_;
+    std::vector<std::string> hosts_;
+    std::vector<int> fds_; // Socket per peer rank, -1 for self
+};
+
+#endif // unix
+
+// Backend chosen by name: "mpi" (default), "shm" or "tcp". The non-MPI backends read
+// their rank and size from MESH_RANK / MESH_SIZE (falling back to the Open MPI / PMI
+// variables a launcher sets), plus MESH_SHM_NAME (default: per launcher job id), or MESH_TCP_HOSTS (comma-separated,
+// one per rank) and MESH_TCP_PORT. Returns null for an unknown name.
+inline HostCoordinator* make_coordinator(const std::string& kind) {
+    if (kind == "mpi") return new MpiCoordinator();
+#if defined(__unix__) || defined(__APPLE__)
+    auto env = [](const char* a, const char* b, const char* c, const char* def) {
+        const char* v = std::getenv(a);
+        if (!v && b) v = std::getenv(b);
+        if (!v && c) v = std::getenv(c);
+        return std::string(v ? v : def);
+    };
+    int rank = std::atoi(env("MESH_RANK", "OMPI_COMM_WORLD_RANK", "PMI_RANK", "0").c_str());
+    int size = std::atoi(env("MESH_SIZE", "OMPI_COMM_WORLD_SIZE", "PMI_SIZE", "1").c_str());
+    if (kind == "shm") {
+        std::string job = env("PMIX_NAMESPACE", "SLURM_JOB_ID", "OMPI_MCA_ess_base_jobid", "");
+        for (char& c : job) if (c == '/' || c == '@') c = '_';
+        return new ShmCoordinator(env("MESH_SHM_NAME", nullptr, nullptr, ("/multi_host_mesh" + job).c_str()), rank, size);
+    }
+    if (kind == "tcp") {
+        std::vector<std::string> hosts;
+        std::stringstream list(env("MESH_TCP_HOSTS", nullptr, nullptr, ""));
+        for (std::string h; std::getline(list, h, ',');) hosts.push_back(h);
+        if (hosts.empty()) hosts.assign(size, "127.0.0.1"); // All ranks on this host
+        return new TcpCoordinator(rank, hosts, uint16_t(std::atoi(env("MESH_TCP_PORT", nullptr, nullptr, "29500").c_str())));
+    }
+#endif
+    return nullptr;
+}
+
+} // namespace mesh
@@ -1,17 +1,33 @@
 #include "multi_host_mesh_runtime.hpp"
+#include "multi_host_mesh_coordination.hpp"
+#include "multi_host_mesh_host_ops.hpp"
+#include "multi_host_mesh_checkpoint.hpp"
 #include <cstdlib>
+#include <cstring>
 #include <stdexcept>
 using namespace mesh;
 
 void usage(const char* prog) {
     std::cerr << "Usage: " << prog << " <mesh_x> <mesh_y> <host_submesh_x> <host_submesh_y>"
-              << " [--validate on|off] [--debug <mode>]\n"
-              << "  mesh_x, mesh_y: overall mesh dimensions (must be powers of 2)\n"
-              << "  host_x, host_y: host submesh dimensions (must be powers of 2)\n"
+              << " [--validate on|off|deferred|nonblocking] [--validate-every <n>] [--debug <mode>] [--dispatch-threads <n>] [--async-depth <n>] [--coord mpi|shm|tcp] [--placement row-major|node|<file>] [--trace <file>] [--stragglers <n>] [--topology mesh|torus]\n"
+              << "  mesh_x, mesh_y: overall mesh dimensions (any non-zero size)\n"
+              << "  host_x, host_y: host submesh dimensions\n"
               << "                  must evenly divide mesh dimensions\n"
-              << "  --validate on|off: Enable or disable runtime validation checks (default: on)\n"
+              << "  --validate on|off|deferred|nonblocking: Enable or disable runtime validation checks (default: on)\n"
+              << "                  'deferred' folds checks into a digest reconciled at wait()/close()\n"
+              << "                  'nonblocking' posts each check and completes it before dispatch\n"
+              << "  --validate-every <n>: With 'deferred', also reconcile every n lockstep ops (default: 0)\n"
               << "  --debug <mode>: Set debug print mode (default: none)\n"
-              << "                  mode can be 'none', 'all', or a specific integer rank ID\n";
+              << "                  mode can be 'none', 'all', or a specific integer rank ID\n"
+              << "  --dispatch-threads <n>: Worker threads draining local DeviceCQs, and running HostOps (default: 0, serial)\n"
+              << "  --async-depth <n>: Dispatch pushes on a background thread, at most n in flight (default: 0, synchronous)\n"
+              << "  --coord mpi|shm|tcp: Host coordination backend (default: mpi). shm: ranks on one host;\n"
+              << "                  tcp: MESH_TCP_HOSTS/MESH_TCP_PORT. Rank/size from MESH_RANK/MESH_SIZE or the launcher\n"
+              << "  --placement row-major|node|<file>: Rank to host submesh mapping (default: row-major).\n"
+              << "                  node: one tile of the host grid per machine; <file>: mesh description\n"
+              << "  --trace <file>: Write a Chrome/Perfetto timeline of every rank to <file> at close\n"
+              << "  --stragglers <n>: Report the slowest and fastest rank every n wait()s (default: 0, off)\n"
+              << "  --topology mesh|torus: Whether the fabric wraps around both mesh axes (default: mesh)\n";
     std::exit(1);
 }
 
@@ -20,8 +36,17 @@ struct ProgramArgs {
     Shape mesh_shape;
     Shape host_submesh_shape;
     bool validation_enabled;
+    bool validation_deferred = false;
+    bool validation_nonblocking = false;
+    uint64_t validation_every = 0;
     mesh::Debug::Mode debug_mode = mesh::Debug::Mode::NONE; // Default debug mode
     int debug_rank = -1;
+    mesh::DispatchConfig dispatch; // Serial dispatch by default
+    std::string coord = "mpi";
+    mesh::PlacementConfig placement; // Row-major by default
+    mesh::Topology topology;         // No wraparound by default
+    std::string trace;               // Timeline trace file, empty = off
+    uint64_t stragglers = 0;         // Straggler report window in wait()s, 0 = off
 };
 
 // Function to parse command line arguments
@@ -54,10 +79,19 @@ ProgramArgs parse_args(int argc, char** argv) {
         if (flag == "--validate") {
             if (value == "on") args.validation_enabled = true;
             else if (value == "off") args.validation_enabled = false;
+            else if (value == "deferred") { args.validation_enabled = true; args.validation_deferred = true; }
+            else if (value == "nonblocking") { args.validation_enabled = true; args.validation_nonblocking = true; }
             else {
-                std::cerr << "Error: Invalid value for --validate flag. Use 'on' or 'off'.\n";
+                std::cerr << "Error: Invalid value for --validate flag. Use 'on', 'off', 'deferred' or 'nonblocking'.\n";
                 usage(argv[0]);
             }
+        } else if (flag == "--validate-every") {
+            long long every = std::atoll(value.c_str());
+            if (every < 0) {
+                std::cerr << "Error: Invalid value for --validate-every flag. Must be non-negative.\n";
+                usage(argv[0]);
+            }
+            args.validation_every = static_cast<uint64_t>(every);
         } else if (flag == "--debug") {
             if (value == "none") {
                 args.debug_mode = mesh::Debug::Mode::NONE;
@@ -83,6 +117,46 @@ ProgramArgs parse_args(int argc, char** argv) {
                     usage(argv[0]);
                 }
             }
+        } else if (flag == "--dispatch-threads") {
+            int threads = std::atoi(value.c_str());
+            if (threads < 0) {
+                std::cerr << "Error: Invalid value for --dispatch-threads flag. Must be non-negative.\n";
+                usage(argv[0]);
+            }
+            args.dispatch.threads = static_cast<size_t>(threads);
+        } else if (flag == "--async-depth") {
+            int depth = std::atoi(value.c_str());
+            if (depth < 0) {
+                std::cerr << "Error: Invalid value for --async-depth flag. Must be non-negative.\n";
+                usage(argv[0]);
+            }
+            args.dispatch.async_depth = static_cast<size_t>(depth);
+        } else if (flag == "--coord") {
+            if (value != "mpi" && value != "shm" && value != "tcp") {
+                std::cerr << "Error: Invalid value for --coord flag. Use 'mpi', 'shm' or 'tcp'.\n";
+                usage(argv[0]);
+            }
+            args.coord = value;
+        } else if (flag == "--placement") {
+            if (value == "row-major") args.placement.policy = PlacementConfig::Policy::ROW_MAJOR;
+            else if (value == "node") args.placement.policy = PlacementConfig::Policy::NODE;
+            else { args.placement.policy = PlacementConfig::Policy::FILE; args.placement.file = value; }
+        } else if (flag == "--trace") {
+            args.trace = value;
+        } else if (flag == "--topology") {
+            if (value == "mesh") args.topology = Topology::mesh();
+            else if (value == "torus") args.topology = Topology::torus();
+            else {
+                std::cerr << "Error: Invalid value for --topology flag. Use 'mesh' or 'torus'.\n";
+                usage(argv[0]);
+            }
+        } else if (flag == "--stragglers") {
+            long long every = std::atoll(value.c_str());
+            if (every < 0) {
+                std::cerr << "Error: Invalid value for --stragglers flag. Must be non-negative.\n";
+                usage(argv[0]);
+            }
+            args.stragglers = static_cast<uint64_t>(every);
         } else {
              std::cerr << "Error: Unknown optional argument '" << flag << "'\n";
              usage(argv[0]);
@@ -102,16 +176,24 @@ inline MeshWorkload fabric_multicast_test(const MeshBuffer& in_buf, const MeshBu
     // Example: Incorporate both buffer sizes into the command (customize as needed)
     uint64_t cmd = (test_pattern << 32) | ((in_buf.bytes() + out_buf.bytes()) & 0xFFFFFFFFULL);
     
-    // Pass target mesh shape to MeshWorkload constructor
-    return MeshWorkload({cmd}, target_mesh_shape);
+    // One multicast to the whole mesh: each host writes it once per submesh row (or
+    // column) and the fabric delivers it to the remaining devices
+    return MeshWorkload::Builder(target_mesh_shape).multicast(cmd, DeviceRange::full(target_mesh_shape)).build();
 }
 
 int main(int argc, char** argv) {
     ProgramArgs args = parse_args(argc, argv);
 
+    if (args.coord != "mpi") HostCoordinator::use(make_coordinator(args.coord)); // Before open
+    if (args.validation_deferred) Validation::defer(args.validation_every);
+    if (args.validation_nonblocking) Validation::nonblocking();
+    if (!args.trace.empty()) Tracer::enable(args.trace);
+    if (args.stragglers) Stragglers::enable(args.stragglers, true);
+
     // Pass config args directly to open
     auto& dev = MeshDevice::open(args.mesh_shape, args.host_submesh_shape, 
-                               args.validation_enabled, args.debug_mode, args.debug_rank);
+                               args.validation_enabled, args.debug_mode, args.debug_rank,
+                               args.dispatch, AllocatorConfig(), args.placement, StartupConfig(), args.topology);
     
     auto& cq  = dev.cq();
 
@@ -123,17 +205,116 @@ int main(int argc, char** argv) {
     MeshBuffer test_buf = dev.allocate(test_shape);
     MeshBuffer output_buf = dev.allocate(test_shape, mesh_shape);
 
-    // WIP: HostBuffer design
-    //  HostBuffer host_buf = dev.allocate_host_buffer<uint64_t>(test_shape, mesh_shape, submesh_shape);
+    // Stage this rank's shard of the input on the host and write it to the local devices.
+    // Each rank fills only its own region; the HostBuffer must outlive the transfer.
+    HostBuffer host_buf = test_buf.host_view();
+    std::memset(host_buf.ptr(), dev.rank() & 0xFF, host_buf.size());
+    cq.enqueue_write(test_buf, host_buf);
 
     // Create and push the multicast test workload
     // All ranks create identical workloads
     // Pass mesh shape to the test function
     MeshWorkload multicast_test = fabric_multicast_test(test_buf, output_buf, mesh_shape); 
-    cq.push(multicast_test);
+    MeshEvent done = cq.push(multicast_test);
+
+    // Local completion of the push (a sync MeshCQ dispatches it now), then a barrier with
+    // only the hosts it touched. The final wait() is the global checkpoint before close.
+    dev.wait(done, true);
+
+    // Round trip through a tilized MeshBuffer, one 32x32 tile per device: tilize this
+    // rank's region, write it, read it back into a fresh (tiled) host_view and untilize.
+    BufferSpec tiled_spec;
+    tiled_spec.dtype  = DataType::UINT32;
+    tiled_spec.layout = HostLayout::TILE;
+    Shape tiled_shape(mesh_shape.x * tiled_spec.tile.w, mesh_shape.y * tiled_spec.tile.h);
+    MeshBuffer tiled_buf = dev.allocate(tiled_shape, tiled_spec);
+    std::vector<uint32_t> tensor(size_t(tiled_shape.x) * tiled_shape.y), tensor_back(tensor.size());
+    for (size_t i = 0; i < tensor.size(); ++i) tensor[i] = uint32_t(i * 2654435761u);
+    HostOps host_ops(args.dispatch.threads); // Tile rows split across as many workers as dispatch
+    HostBuffer tiles = tiled_buf.host_view();
+    host_ops.tilize(tensor.data(), tiled_shape, tiles);
+    cq.enqueue_write(tiled_buf, tiles);
+    HostBuffer tiles_back = tiled_buf.host_view();
+    dev.wait(cq.enqueue_read(tiled_buf, tiles_back));
+    host_ops.untilize(tiles_back, tensor_back.data(), tiled_shape);
+    const TensorRegion& mine = tiles_back.region();
+    for (uint32_t y = mine.y_range.start; y < mine.y_range.end; ++y) {
+        size_t row = size_t(y) * tiled_shape.x + mine.x_range.start;
+        if (std::memcmp(&tensor[row], &tensor_back[row], mine.width() * sizeof(uint32_t)) != 0) {
+            std::cerr << "[rank " << dev.rank() << "] Error: tilized MeshBuffer round trip differs in row " << y << "\n";
+            HostCoordinator::get().abort(1);
+        }
+    }
+    dev.deallocate(tiled_buf);
+
+    // Checkpoint round trip: rank 0 saves a whole tensor, then every rank streams its
+    // region into a sharded MeshBuffer in bands of 4 rows (several bands, so the
+    // read-ahead window is used) and reads it back.
+    const std::string ckpt_path = "multi_host_mesh_example.ckpt";
+    Shape ckpt_shape(mesh_shape.x * 16, mesh_shape.y * 24);
+    std::vector<uint16_t> weights(size_t(ckpt_shape.x) * ckpt_shape.y);
+    for (size_t i = 0; i < weights.size(); ++i) weights[i] = uint16_t(i * 40503u);
+    if (dev.rank() == 0) {
+        std::vector<CheckpointTensor> tensors = { { "weights", DataType::UINT16, ckpt_shape, weights.data() } };
+        if (!Checkpoint::save(ckpt_path, tensors)) {
+            std::cerr << "[rank 0] Error: cannot write checkpoint " << ckpt_path << "\n";
+            HostCoordinator::get().abort(1);
+        }
+    }
+    dev.wait(); // The file is complete before any rank maps it
+    {
+        Checkpoint ckpt(ckpt_path);
+        BufferSpec ckpt_spec;
+        ckpt_spec.dtype = DataType::UINT16; // Sharded along both axes
+        MeshBuffer ckpt_buf = dev.allocate(ckpt_shape, ckpt_spec);
+        CheckpointLoadConfig load_cfg;
+        load_cfg.band_bytes = 4 * size_t(ckpt_buf.host_region().width()) * sizeof(uint16_t);
+        dev.wait(ckpt.load(dev, ckpt_buf, "weights", load_cfg));
+        HostBuffer loaded = ckpt_buf.host_view();
+        dev.wait(cq.enqueue_read(ckpt_buf, loaded));
+        const TensorRegion& part = loaded.region();
+        for (uint32_t y = part.y_range.start; y < part.y_range.end; ++y) {
+            const uint8_t* row = static_cast<const uint8_t*>(loaded.ptr()) + (y - part.y_range.start) * loaded.row_pitch();
+            if (std::memcmp(row, &weights[size_t(y) * ckpt_shape.x + part.x_range.start], loaded.row_pitch()) != 0) {
+                std::cerr << "[rank " << dev.rank() << "] Error: checkpoint round trip differs in row " << y << "\n";
+                HostCoordinator::get().abort(1);
+            }
+        }
+        dev.deallocate(ckpt_buf);
+    }
+
+    // Submesh over the top half of the rows: its own MeshCQ and DeviceCQs over the same
+    // Devices, in its own coordinates. Only its devices get the commands, only the hosts
+    // owning them join the scoped sync, and the root MeshCQ sees none of it.
+    {
+        const DeviceRange top(Range(0, mesh_shape.x), Range(0, (mesh_shape.y + 1) / 2));
+        std::shared_ptr<MeshDevice> half = dev.create_submesh(top, args.dispatch);
+        const Shape half_shape = half->mesh_shape();
+        for (uint32_t y = 0; y < half_shape.y; ++y) {
+            for (uint32_t x = 0; x < half_shape.x; ++x) {
+                const Shape c(x, y);
+                const MeshDevice::DeviceLocation loc = half->locate(c);
+                bool ok = loc.rank == dev.locate(Shape(x + top.x_range.start, y + top.y_range.start)).rank;
+                if (loc.rank == dev.rank()) ok = ok && half->is_local(c) && half->local_index(c) == loc.local_index;
+                if (!ok) {
+                    std::cerr << "[rank " << dev.rank() << "] Error: submesh lookup of (" << x << "," << y << ") is wrong\n";
+                    HostCoordinator::get().abort(1);
+                }
+            }
+        }
+        const uint64_t words[2] = { 0x5355424d45534801ULL, 0x5355424d45534802ULL };
+        const uint64_t root_words = cq.host_words(), half_words = half->cq().host_words();
+        MeshWorkload per_device = MeshWorkload::Builder(half_shape).add(words, 2, DeviceRange::full(half_shape)).build();
+        half->wait(half->cq().push(per_device), true);
+        if (half->cq().host_words() - half_words != 2 * half->local_device_count() || cq.host_words() != root_words) {
+            std::cerr << "[rank " << dev.rank() << "] Error: submesh push enqueued " << half->cq().host_words() - half_words
+                      << " word(s) for " << half->local_device_count() << " device(s)\n";
+            HostCoordinator::get().abort(1);
+        }
+    }
 
-    dev.dispatch_pending();
     dev.wait();
+    if (dev.rank() == 0) std::remove(ckpt_path.c_str()); // Every rank has unmapped it
 
     MeshDevice::close();
     return 0;
@@ -0,0 +1,142 @@
+#pragma once
+#include "multi_host_mesh_runtime.hpp"
+
+namespace mesh {
+
+// Host-side layout transforms over the rank-local region of a MeshBuffer.
+//
+// Every function works on exactly HostBuffer::region(), i.e. the shard(s) owned by this
+// rank's host submesh, so no rank reads or writes elements it does not own. The copy
+// into the pooled staging buffer and the layout change are fused into one pass, split
+// by rows of tiles across a WorkerPool. Inner copies are contiguous face rows, which
+// memcpy/the compiler lower to the widest vector moves the target has (AVX2, AVX-512,
+// NEON) without per-ISA code here.
+class HostOps {
+public:
+    // threads = 0: run on the calling thread only
+    explicit HostOps(size_t threads = 0) {
+        if (threads) {
+            DispatchConfig cfg;
+            cfg.threads = threads;
+            pool_.reset(new WorkerPool(cfg, "host ops worker"));
+        }
+    }
+
+    // Row-major copy of dst.region() out of the global row-major tensor `src` of shape
+    // `src_shape`; elements outside src_shape (padding) are set to `pad_bits`.
+    void stage(const void* src, Shape src_shape, HostBuffer& dst, uint32_t pad_bits = 0) {
+        dst.layout_ = HostLayout::ROW_MAJOR;
+        const TensorRegion& r = dst.region();
+        const size_t es = element_size(dst.dtype());
+        uint8_t* out = static_cast<uint8_t*>(dst.ptr());
+        const size_t pitch = dst.row_pitch();
+        parallel(r.height(), [&](size_t row) {
+            copy_padded(static_cast<const uint8_t*>(src), src_shape, es,
+                        r.y_range.start + static_cast<uint32_t>(row), r.x_range.start, r.width(),
+                        out + row * pitch, pad_bits);
+        });
+    }
+
+    // Fused tilize + pad: dst.region() must be a whole number of tiles (allocate the
+    // MeshBuffer with its padded shape); elements outside src_shape are `pad_bits`.
+    // Marks dst as HostLayout::TILE; enqueue_write then moves whole tiles per device into
+    // a MeshBuffer allocated with BufferSpec::layout TILE and the same tile.
+    void tilize(const void* src, Shape src_shape, HostBuffer& dst, uint32_t pad_bits = 0,
+                const TileShape& tile = TileShape()) {
+        const TensorRegion& r = dst.region();
+        check_tiled(r, tile);
+        dst.layout_ = HostLayout::TILE;
+        dst.tile_ = tile;
+        const size_t es = element_size(dst.dtype());
+        const size_t tiles_x = r.width() / tile.w;
+        const size_t faces_x = tile.w / tile.face_w;
+        const size_t tile_bytes = static_cast<size_t>(tile.h) * tile.w * es;
+        const size_t face_bytes = static_cast<size_t>(tile.face_h) * tile.face_w * es;
+        uint8_t* out = static_cast<uint8_t*>(dst.ptr());
+
+        parallel(r.height() / tile.h, [&](size_t ty) {
+            uint8_t* tile_row = out + ty * tiles_x * tile_bytes;
+            for (uint32_t y = 0; y < tile.h; ++y) {
+                const uint32_t gy = r.y_range.start + static_cast<uint32_t>(ty) * tile.h + y;
+                const size_t face_y = y / tile.face_h, in_face_y = y % tile.face_h;
+                for (size_t tx = 0; tx < tiles_x; ++tx) {
+                    for (size_t fx = 0; fx < faces_x; ++fx) {
+                        uint8_t* d = tile_row + tx * tile_bytes + (face_y * faces_x + fx) * face_bytes
+                                   + in_face_y * tile.face_w * es;
+                        const uint32_t gx = r.x_range.start + static_cast<uint32_t>(tx * tile.w + fx * tile.face_w);
+                        copy_padded(static_cast<const uint8_t*>(src), src_shape, es, gy, gx, tile.face_w, d, pad_bits);
+                    }
+                }
+            }
+        });
+    }
+
+    // Inverse of tilize: scatter the tiled src.region() back into the global row-major
+    // tensor `dst` of shape `dst_shape`, dropping padding. `src` is typically the
+    // host_view() of a tilized MeshBuffer after enqueue_read.
+    void untilize(const HostBuffer& src, void* dst, Shape dst_shape) {
+        const TensorRegion& r = src.region();
+        const TileShape& tile = src.tile();
+        check_tiled(r, tile);
+        assert(src.layout() == HostLayout::TILE && "untilize of a HostBuffer that was not tilized");
+        const size_t es = element_size(src.dtype());
+        const size_t tiles_x = r.width() / tile.w;
+        const size_t faces_x = tile.w / tile.face_w;
+        const size_t tile_bytes = static_cast<size_t>(tile.h) * tile.w * es;
+        const size_t face_bytes = static_cast<size_t>(tile.face_h) * tile.face_w * es;
+        const uint8_t* in = static_cast<const uint8_t*>(src.ptr());
+        uint8_t* out = static_cast<uint8_t*>(dst);
+
+        parallel(r.height() / tile.h, [&](size_t ty) {
+            const uint8_t* tile_row = in + ty * tiles_x * tile_bytes;
+            for (uint32_t y = 0; y < tile.h; ++y) {
+                const uint32_t gy = r.y_range.start + static_cast<uint32_t>(ty) * tile.h + y;
+                if (gy >= dst_shape.y) break;
+                const size_t face_y = y / tile.face_h, in_face_y = y % tile.face_h;
+                for (size_t tx = 0; tx < tiles_x; ++tx) {
+                    for (size_t fx = 0; fx < faces_x; ++fx) {
+                        const uint32_t gx = r.x_range.start + static_cast<uint32_t>(tx * tile.w + fx * tile.face_w);
+                        if (gx >= dst_shape.x) continue;
+                        const uint32_t n = std::min(tile.face_w, dst_shape.x - gx);
+                        const uint8_t* s = tile_row + tx * tile_bytes + (face_y * faces_x + fx) * face_bytes
+                                         + in_face_y * tile.face_w * es;
+                        std::memcpy(out + (static_cast<size_t>(gy) * dst_shape.x + gx) * es, s, n * es);
+                    }
+                }
+            }
+        });
+    }
+
+private:
+    void parallel(size_t count, const std::function<void(size_t)>& task) {
+        if (pool_) pool_->parallel_for(count, task);
+        else for (size_t i = 0; i < count; ++i) task(i);
+    }
+
+    static void check_tiled(const TensorRegion& r, const TileShape& tile) {
+        assert(tile.h % tile.face_h == 0 && tile.w % tile.face_w == 0 && "faces must tile the tile");
+        assert(r.width() % tile.w == 0 && r.height() % tile.h == 0 &&
+               "HostBuffer region is not a whole number of tiles; allocate the MeshBuffer padded");
+        (void)r; (void)tile;
+    }
+
+    // n elements of row gy starting at column gx; out-of-bounds elements become padding
+    static void copy_padded(const uint8_t* src, Shape shape, size_t es, uint32_t gy, uint32_t gx, uint32_t n,
+                            uint8_t* out, uint32_t pad_bits) {
+        uint32_t valid = (gy < shape.y && gx < shape.x) ? std::min(n, shape.x - gx) : 0;
+        if (valid) std::memcpy(out, src + (static_cast<size_t>(gy) * shape.x + gx) * es, valid * es);
+        if (valid < n) fill(out + valid * es, n - valid, es, pad_bits);
+    }
+
+    static void fill(uint8_t* out, size_t n, size_t es, uint32_t bits) {
+        switch (es) {
+            case 1: std::memset(out, static_cast<int>(bits & 0xFF), n); break;
+            case 2: { uint16_t v = static_cast<uint16_t>(bits); for (size_t i = 0; i < n; ++i) std::memcpy(out + 2 * i, &v, 2); break; }
+            default: for (size_t i = 0; i < n; ++i) std::memcpy(out + 4 * i, &bits, 4); break;
+        }
+    }
+
+    std::unique_ptr<WorkerPool> pool_;
+};
+
+}  // namespace mesh
@@ -11,15 +11,67 @@
 #include <iomanip>
 #include <limits> // Required for numeric_limits
 #include <string>   // Required for std::stoi
+#include <memory>   // Required for std::shared_ptr
+#include <new>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <iterator>
+#include <cstring>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Build-time configuration of the host-side diagnostics. -DMESH_RELEASE compiles Debug
+// prints and lockstep Validation out; MESH_DEBUG / MESH_VALIDATION (0 or 1) set either one
+// explicitly. Compiled out, the runtime switches (--debug, --validate, Debug::configure,
+// Validation::enabled) are ignored and every check folds to a constant false, so the
+// branches, and the rank lookups and hashing behind them, are removed from the hot paths.
+#ifndef MESH_DEBUG
+#  ifdef MESH_RELEASE
+#    define MESH_DEBUG 0
+#  else
+#    define MESH_DEBUG 1
+#  endif
+#endif
+#ifndef MESH_VALIDATION
+#  ifdef MESH_RELEASE
+#    define MESH_VALIDATION 0
+#  else
+#    define MESH_VALIDATION 1
+#  endif
+#endif
 
 namespace mesh {
 
+struct BuildConfig {
+    static constexpr bool debug      = MESH_DEBUG != 0;
+    static constexpr bool validation = MESH_VALIDATION != 0;
+};
+
 // Debug Print Configuration Namespace
 namespace Debug {
     enum class Mode { NONE, ALL, SPECIFIC_RANK };
     static Mode current_mode = Mode::NONE;
     static int target_rank = -1; // Target rank if mode is SPECIFIC_RANK
 
+    // Any rank prints at all; false at compile time when Debug is compiled out
+    inline bool enabled() { return BuildConfig::debug && current_mode != Mode::NONE; }
+
     // Configure debug printing. Should be called after MPI_Init potentially.
     inline void configure(Mode mode, int rank_id = -1) {
         current_mode = mode;
@@ -30,6 +82,7 @@ namespace Debug {
 
     // Check if the current rank should print debug messages
     inline bool should_print(int current_process_rank) {
+        if (!BuildConfig::debug) return false;
         switch (current_mode) {
             case Mode::NONE:
                 return false;
@@ -49,22 +102,217 @@ struct Shape {
 struct Range { 
     uint32_t start{}, end{}; 
     Range(uint32_t s = 0, uint32_t e = 0) : start(s), end(e) {}
+    bool     empty() const { return end <= start; }
+    uint32_t size()  const { return empty() ? 0 : end - start; }
+    bool     contains(uint32_t v) const { return v >= start && v < end; }
+    Range intersect(const Range& o) const {
+        return Range(start > o.start ? start : o.start, end < o.end ? end : o.end);
+    }
+};
+
+// Rectangular set of devices in global mesh coordinates, [x_range) x [y_range).
+// Used to target commands of a MeshWorkload at part of the mesh (e.g. one TP row).
+struct DeviceRange {
+    Range x_range;
+    Range y_range;
+    DeviceRange() {}
+    DeviceRange(Range x, Range y) : x_range(x), y_range(y) {}
+
+    static DeviceRange full(Shape mesh)               { return DeviceRange({0, mesh.x}, {0, mesh.y}); }
+    static DeviceRange device(Shape coord)            { return DeviceRange({coord.x, coord.x + 1}, {coord.y, coord.y + 1}); }
+    static DeviceRange row(uint32_t y, Shape mesh)    { return DeviceRange({0, mesh.x}, {y, y + 1}); }
+    static DeviceRange column(uint32_t x, Shape mesh) { return DeviceRange({x, x + 1}, {0, mesh.y}); }
+
+    bool empty() const { return x_range.empty() || y_range.empty(); }
+    Shape shape() const { return Shape(x_range.size(), y_range.size()); }
+    bool contains(Shape coord) const { return x_range.contains(coord.x) && y_range.contains(coord.y); }
+    DeviceRange intersect(const DeviceRange& o) const {
+        return DeviceRange(x_range.intersect(o.x_range), y_range.intersect(o.y_range));
+    }
+    // Smallest range covering both (an empty side is ignored)
+    DeviceRange bounding(const DeviceRange& o) const {
+        if (empty()) return o;
+        if (o.empty()) return *this;
+        return DeviceRange({std::min(x_range.start, o.x_range.start), std::max(x_range.end, o.x_range.end)},
+                           {std::min(y_range.start, o.y_range.start), std::max(y_range.end, o.y_range.end)});
+    }
+    bool operator==(const DeviceRange& o) const {
+        return x_range.start == o.x_range.start && x_range.end == o.x_range.end &&
+               y_range.start == o.y_range.start && y_range.end == o.y_range.end;
+    }
+};
+
+// Immutable, reference-counted view of a contiguous run of command words.
+// A MeshWorkload owns its words once; every DeviceCQ that receives the workload
+// holds a CmdSegment handle onto the same storage instead of a private copy.
+class CmdSegment {
+public:
+    typedef std::shared_ptr<const std::vector<uint64_t> > Storage;
+
+    CmdSegment() : offset_(0), count_(0) {}
+    CmdSegment(Storage storage, size_t offset, size_t count)
+        : storage_(std::move(storage)), offset_(offset), count_(count)
+    {
+        assert(storage_ && offset_ + count_ <= storage_->size() && "CmdSegment out of range");
+    }
+    explicit CmdSegment(Storage storage)
+        : storage_(std::move(storage)), offset_(0), count_(storage_ ? storage_->size() : 0) {}
+
+    const uint64_t* data()  const { return count_ ? storage_->data() + offset_ : nullptr; }
+    const uint64_t* begin() const { return data(); }
+    const uint64_t* end()   const { return data() + count_; }
+    size_t size()  const { return count_; }
+    bool   empty() const { return count_ == 0; }
+
+private:
+    Storage storage_;
+    size_t  offset_;
+    size_t  count_;
+};
+
+// One device's part of a host<->device transfer: a strided 2D copy between user host
+// memory and that device's shard of a MeshBuffer. The descriptor points straight at the
+// HostBuffer rows, so no intermediate staging copy is made.
+struct Transfer {
+    enum class Dir { WRITE, READ };
+    Dir      dir = Dir::WRITE;
+    uint8_t* host = nullptr;   // First byte of the copy in host memory
+    size_t   host_pitch = 0;   // Bytes between rows in host memory
+    uint64_t device_key = 0;   // Buffer type and bank-local address
+    size_t   device_bytes = 0; // Size of the device's whole shard
+    size_t   device_offset = 0;// First byte of the copy within the shard
+    size_t   device_pitch = 0; // Bytes between rows of the shard
+    size_t   row_bytes = 0;
+    uint32_t rows = 0;
+    size_t   bytes() const { return row_bytes * rows; }
 };
 
 // Moved DeviceCQ and Device definitions after Shape/Range
-struct DeviceCQ {
-    std::vector<uint64_t> cmds_;
+// Bounded single-producer / single-consumer ring of commands and transfers, executed in
+// enqueue order. Laid out like the device-side hardware CQ: power-of-two slots, with the
+// producer's and the consumer's index (and counters) on separate cache lines, so the
+// thread enqueueing (MeshCQ) and the one draining (dispatch) run concurrently without
+// locks. A full ring is the producer's backpressure signal (see MeshCQ::put).
+class DeviceCQ {
+public:
+    // Commands or a transfer. fabric_words of cmds reach the device over the fabric from
+    // a multicast head device (see CmdRun::multicast) instead of being written by the host.
+    // Transfers are rare next to commands, so they live out of line and a slot stays small.
+    struct Entry {
+        CmdSegment cmds;
+        std::shared_ptr<const Transfer> xfer; // Null for commands
+        size_t     fabric_words = 0;
+        bool is_transfer() const { return xfer != nullptr; }
+    };
+    enum { kCacheLine = 64 };
+
+    explicit DeviceCQ(size_t capacity) : ring_(new Ring(capacity)) {}
+
+    // Producer side (one thread at a time): false, and nothing enqueued, when full
+    bool try_enqueue(const CmdSegment& seg, size_t fabric_words = 0) { return publish(seg, nullptr, fabric_words); }
+    bool try_enqueue(const Transfer& t) { return publish(CmdSegment(), &t, 0); }
+
+    // Consumer side (one thread at a time): hand every entry published so far to `f`, in
+    // order, then release their slots. Returns the number of entries.
+    template <typename F> size_t drain(F f) {
+        Ring& r = *ring_;
+        const size_t head = r.consumer.head.load(std::memory_order_relaxed);
+        const size_t tail = r.producer.tail.load(std::memory_order_acquire);
+        size_t words = 0, transfers = 0;
+        for (size_t i = head; i != tail; ++i) {
+            Entry& e = r.slots[i & r.mask];
+            f(static_cast<const Entry&>(e));
+            words += e.cmds.size();
+            transfers += e.is_transfer();
+            e.cmds = CmdSegment(); // Drop the workload handle before the slot is reused
+            e.xfer.reset();
+        }
+        Ring::Consumer& c = r.consumer;
+        c.words_out.store(c.words_out.load(std::memory_order_relaxed) + words, std::memory_order_relaxed);
+        c.transfers_out.store(c.transfers_out.load(std::memory_order_relaxed) + transfers, std::memory_order_relaxed);
+        c.head.store(tail, std::memory_order_release);
+        return tail - head;
+    }
+
+    // Either side; approximate while the other one is running
+    bool   empty() const { return entries() == 0; }
+    size_t entries() const {
+        return ring_->producer.tail.load(std::memory_order_acquire) - ring_->consumer.head.load(std::memory_order_acquire);
+    }
+    size_t size() const { // Pending command words
+        return ring_->producer.words_in.load(std::memory_order_relaxed) -
+               ring_->consumer.words_out.load(std::memory_order_relaxed);
+    }
+    size_t transfers() const {
+        return ring_->producer.transfers_in.load(std::memory_order_relaxed) -
+               ring_->consumer.transfers_out.load(std::memory_order_relaxed);
+    }
+    size_t capacity() const { return ring_->mask + 1; }
+
+private:
+    struct Ring {
+        explicit Ring(size_t capacity) {
+            size_t n = 2;
+            while (n < capacity) n <<= 1;
+            slots.resize(n);
+            mask = n - 1;
+        }
+        // Heap-allocated through ring_, so it has to honour the cache line alignment
+        // itself (over-aligned new is C++17)
+        static void* operator new(size_t bytes) {
+            void* p = nullptr;
+            if (posix_memalign(&p, kCacheLine, bytes) != 0) throw std::bad_alloc();
+            return p;
+        }
+        static void operator delete(void* p) { free(p); }
+
+        std::vector<Entry> slots;
+        size_t mask;
+        struct alignas(kCacheLine) Producer { // Written by the producer only
+            std::atomic<size_t> tail{0};
+            std::atomic<size_t> words_in{0}, transfers_in{0};
+            size_t head_seen = 0; // Last view of head, to rarely touch the consumer's line
+        } producer;
+        struct alignas(kCacheLine) Consumer { // Written by the consumer only
+            std::atomic<size_t> head{0};
+            std::atomic<size_t> words_out{0}, transfers_out{0};
+        } consumer;
+    };
+
+    bool publish(const CmdSegment& seg, const Transfer* t, size_t fabric_words) {
+        Ring& r = *ring_;
+        Ring::Producer& p = r.producer;
+        const size_t tail = p.tail.load(std::memory_order_relaxed);
+        if (tail - p.head_seen > r.mask) {
+            p.head_seen = r.consumer.head.load(std::memory_order_acquire);
+            if (tail - p.head_seen > r.mask) return false;
+        }
+        Entry& e = r.slots[tail & r.mask];
+        e.cmds = seg;
+        if (t) e.xfer = std::make_shared<const Transfer>(*t);
+        e.fabric_words = fabric_words;
+        p.words_in.store(p.words_in.load(std::memory_order_relaxed) + seg.size(), std::memory_order_relaxed);
+        p.transfers_in.store(p.transfers_in.load(std::memory_order_relaxed) + (t != nullptr), std::memory_order_relaxed);
+        p.tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::unique_ptr<Ring> ring_; // Stable address for both sides; DeviceCQ itself is movable
 };
 
 class Device {
 public:
     Shape global_coords; // Global coordinates of this device
     Shape local_coords;  // Local coordinates within the host submesh
-    DeviceCQ cq_;        // Command queue for this specific device
 
     explicit Device(Shape global_c, Shape local_c) 
         : global_coords(global_c), local_coords(local_c) {}
 
+    // Called once at MeshDevice::open, concurrently for distinct devices.
+    // In a real implementation: reset, load firmware, train the fabric links (slow).
+    void bring_up() { ready_ = true; }
+    bool ready() const { return ready_; }
+
     void print_creation_info(int rank) const {
         if (Debug::should_print(rank)) {
             std::cout << "[rank " << rank << "] Initialized Device @ global (" 
@@ -72,6 +320,68 @@ public:
                       << local_coords.x << "," << local_coords.y << ")\n";
         }
     }
+
+    // Mock DMA between host memory and this device's memory, one row at a time.
+    // In a real implementation: program the device's DMA engine with the host rows directly.
+    void execute(const Transfer& t) {
+        std::vector<uint8_t>& shard = memory_[t.device_key];
+        if (shard.size() != t.device_bytes) shard.resize(t.device_bytes);
+        for (uint32_t r = 0; r < t.rows; ++r) {
+            uint8_t* dev  = shard.data() + t.device_offset + r * t.device_pitch;
+            uint8_t* host = t.host + r * t.host_pitch;
+            if (t.dir == Transfer::Dir::WRITE) std::memcpy(dev, host, t.row_bytes);
+            else                               std::memcpy(host, dev, t.row_bytes);
+        }
+    }
+
+private:
+    std::map<uint64_t, std::vector<uint8_t> > memory_; // Mock device memory, by buffer
+    bool ready_ = false;
+};
+
+// One MeshDevice's local devices as a struct of arrays, indexed by local index (row-major
+// over its host submesh, see MeshDevice::local_index): coordinate scans touch only
+// `coords`, dispatch only `queues`. The opened mesh and each of its submeshes have their
+// own table, and so their own DeviceCQs, over the shared physical Devices.
+struct LocalDeviceTable {
+    std::vector<Shape>    coords;  // In this MeshDevice's coordinates
+    std::vector<Device*>  devices; // Owned by the opened MeshDevice
+    std::vector<DeviceCQ> queues;
+
+    size_t size() const { return coords.size(); }
+    void add(Device* device, Shape coord, size_t cq_entries) {
+        coords.push_back(coord);
+        devices.push_back(device);
+        queues.push_back(DeviceCQ(cq_entries));
+    }
+};
+
+enum class Axis { X, Y };
+
+// Wraparound links of the fabric per mesh axis: none (a plain mesh), or a ring along x
+// and/or y (both: a 2D torus). Neighbour queries are O(1) and apply the same rule to
+// device coordinates in a mesh and to host coordinates in the host grid. Meshes are 2D
+// only; a 3D torus has no faithful mapping onto these two axes.
+struct Topology {
+    bool wrap_x = false, wrap_y = false;
+    static Topology mesh()  { return Topology(); }
+    static Topology torus() { Topology t; t.wrap_x = t.wrap_y = true; return t; }
+    bool wraps(Axis axis) const { return axis == Axis::X ? wrap_x : wrap_y; }
+
+    // The cell `step` hops from `coord` along `axis` of an `extent`-sized grid; false if
+    // that runs off an edge without wraparound
+    bool neighbor(Shape extent, Shape coord, Axis axis, int32_t step, Shape& out) const {
+        const int64_t n = axis == Axis::X ? extent.x : extent.y;
+        int64_t v = int64_t(axis == Axis::X ? coord.x : coord.y) + step;
+        if (v < 0 || v >= n) {
+            if (!wraps(axis)) return false;
+            v %= n;
+            if (v < 0) v += n;
+        }
+        out = coord;
+        (axis == Axis::X ? out.x : out.y) = uint32_t(v);
+        return true;
+    }
 };
 
 inline std::string to_string(const Shape& s) {
@@ -82,21 +392,27 @@ inline std::string to_string(const Range& r) {
     return "[" + std::to_string(r.start) + ".." + std::to_string(r.end) + ")";
 }
 
-inline bool is_power_of_2(uint32_t n) {
-    return n > 0 && (n & (n - 1)) == 0;
+inline std::string to_string(const DeviceRange& d) {
+    return "x" + to_string(d.x_range) + " y" + to_string(d.y_range);
 }
 
+inline std::string to_string(const Topology& t) {
+    return t.wrap_x && t.wrap_y ? "torus" : t.wrap_x ? "ring in x" : t.wrap_y ? "ring in y" : "mesh";
+}
+
+// Any non-zero sizes: a host submesh only has to divide the mesh (e.g. 12x4 over 4x4
+// hosts), and all partitioning math is division by the submesh shape
 inline Shape validate_mesh_shape(Shape shape) {
-    if (!is_power_of_2(shape.x) || !is_power_of_2(shape.y)) {
-        std::cerr << "Error: mesh dimensions must be powers of 2\n";
+    if (shape.x == 0 || shape.y == 0) {
+        std::cerr << "Error: mesh dimensions must be non-zero\n";
         std::exit(1);
     }
     return shape;
 }
 
 inline Shape validate_host_submesh_shape(Shape mesh_shape, Shape host_submesh_shape) {
-    if (!is_power_of_2(host_submesh_shape.x) || !is_power_of_2(host_submesh_shape.y)) {
-        std::cerr << "Error: host submesh dimensions must be powers of 2\n";
+    if (host_submesh_shape.x == 0 || host_submesh_shape.y == 0) {
+        std::cerr << "Error: host submesh dimensions must be non-zero\n";
         std::exit(1);
     }
     if (mesh_shape.x % host_submesh_shape.x != 0 || mesh_shape.y % host_submesh_shape.y != 0) {
@@ -106,86 +422,1809 @@ inline Shape validate_host_submesh_shape(Shape mesh_shape, Shape host_submesh_sh
     return host_submesh_shape;
 }
 
+// splitmix64 finalizer; cheap 64-bit avalanche used to fold validation digests
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Streaming, order-sensitive 64-bit hash over 64-bit words (xxHash64-style).
+// Four independent accumulator lanes consume 4-word stripes, so the inner loop has no
+// cross-lane dependency and vectorizes; update() may be called any number of times.
+class StreamHash64 {
+public:
+    explicit StreamHash64(uint64_t seed = 0) : len_(0), pending_(0) {
+        acc_[0] = seed + P1 + P2; acc_[1] = seed + P2;
+        acc_[2] = seed;           acc_[3] = seed - P1;
+    }
+
+    void update(uint64_t w) { update(&w, 1); }
+    void update(const uint64_t* w, size_t n) {
+        len_ += n;
+        while (pending_ && n) { buf_[pending_++] = *w++; --n; if (pending_ == 4) { stripe(buf_); pending_ = 0; } }
+        for (; n >= 4; w += 4, n -= 4) stripe(w);
+        while (n--) buf_[pending_++] = *w++;
+    }
+
+    uint64_t digest() const {
+        uint64_t h;
+        if (len_ >= 4) {
+            h = rotl(acc_[0], 1) + rotl(acc_[1], 7) + rotl(acc_[2], 12) + rotl(acc_[3], 18);
+            for (int i = 0; i < 4; ++i) h = (h ^ round(0, acc_[i])) * P1 + P4;
+        } else {
+            h = acc_[2] + P5; // seed + P5
+        }
+        h += len_ * 8;
+        for (size_t i = 0; i < pending_; ++i) h = rotl(h ^ round(0, buf_[i]), 27) * P1 + P4;
+        h ^= h >> 33; h *= P2;
+        h ^= h >> 29; h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static const uint64_t P1 = 0x9E3779B185EBCA87ULL, P2 = 0xC2B2AE3D27D4EB4FULL, P3 = 0x165667B19E3779F9ULL,
+                          P4 = 0x85EBCA77C2B2AE63ULL, P5 = 0x27D4EB2F165667C5ULL;
+    static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    static uint64_t round(uint64_t acc, uint64_t in) { return rotl(acc + in * P2, 31) * P1; }
+    void stripe(const uint64_t* w) {
+        for (int i = 0; i < 4; ++i) acc_[i] = round(acc_[i], w[i]);
+    }
+
+    uint64_t acc_[4];
+    uint64_t buf_[4];
+    uint64_t len_;
+    size_t   pending_;
+};
+
+// Host coordination primitives the runtime needs (see README "Host Coordination
+// Dependency"). Every call is collective over all ranks, or over `ranks` (ascending,
+// containing rank()) for the scoped variants, and must be made in the same order by
+// each participant; ranks outside `ranks` take no part. MPI is the default;
+// multi_host_mesh_coordination.hpp adds shared-memory and TCP backends.
+class HostCoordinator {
+public:
+    // In-flight allreduce; its buffers must stay put until wait() returns
+    class Request {
+    public:
+        virtual ~Request() {}
+        virtual void wait() = 0;
+    };
+
+    virtual ~HostCoordinator() {}
+    virtual const char* name() const = 0;
+    virtual int  rank() const = 0;
+    virtual int  size() const = 0;
+    virtual void barrier() = 0;
+    virtual void barrier(const std::vector<int>& ranks) = 0;
+    // Element-wise minimum of n words over all ranks / over `ranks`
+    virtual void allreduce_min(const uint64_t* in, uint64_t* out, size_t n) = 0;
+    virtual void allreduce_min(const std::vector<int>& ranks, const uint64_t* in, uint64_t* out, size_t n) = 0;
+    // Nonblocking allreduce_min. Default: completes now and returns null (nothing to wait on)
+    virtual std::unique_ptr<Request> post_allreduce_min(const uint64_t* in, uint64_t* out, size_t n) {
+        allreduce_min(in, out, n);
+        return std::unique_ptr<Request>();
+    }
+    virtual std::unique_ptr<Request> post_allreduce_min(const std::vector<int>& ranks,
+                                                        const uint64_t* in, uint64_t* out, size_t n) {
+        allreduce_min(ranks, in, out, n);
+        return std::unique_ptr<Request>();
+    }
+    // Collective: ranks running on this rank's physical node, ascending. Default: just this one
+    virtual std::vector<int> node_ranks() { return std::vector<int>(1, rank()); }
+    virtual void abort(int code) = 0; // Terminates every rank
+    virtual void finalize() {}
+
+    // Process-wide backend; install with use() before MeshDevice::open, MPI otherwise
+    static HostCoordinator& get();
+    static void use(HostCoordinator* backend) { slot().reset(backend); } // Takes ownership
+
+private:
+    static std::unique_ptr<HostCoordinator>& slot() { static std::unique_ptr<HostCoordinator> c; return c; }
+};
+
+class MpiCoordinator : public HostCoordinator {
+public:
+    // The runtime runs threads of its own (bring-up, dispatch workers, the async MeshCQ,
+    // HostOps) but keeps every MPI call on the thread that opened the mesh: FUNNELED.
+    MpiCoordinator() {
+        int init = 0, provided = MPI_THREAD_SINGLE;
+        MPI_Initialized(&init);
+        if (!init) MPI_Init_thread(nullptr, nullptr, MPI_THREAD_FUNNELED, &provided);
+        else       MPI_Query_thread(&provided);
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank_);
+        MPI_Comm_size(MPI_COMM_WORLD, &size_);
+        if (provided < MPI_THREAD_FUNNELED) {
+            if (rank_ == 0) {
+                std::cerr << "Error: the MPI library provides thread level " << provided
+                          << ", the runtime needs MPI_THREAD_FUNNELED (" << MPI_THREAD_FUNNELED << ")"
+                          << (init ? "; initialize MPI with MPI_Init_thread" : "") << "\n";
+            }
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    const char* name() const override { return "mpi"; }
+    int  rank() const override { return rank_; }
+    int  size() const override { return size_; }
+    void barrier() override { MPI_Barrier(MPI_COMM_WORLD); }
+    void barrier(const std::vector<int>& ranks) override { MPI_Barrier(comm(ranks)); }
+    void allreduce_min(const uint64_t* in, uint64_t* out, size_t n) override {
+        MPI_Allreduce(in, out, static_cast<int>(n), MPI_UINT64_T, MPI_MIN, MPI_COMM_WORLD);
+    }
+    void allreduce_min(const std::vector<int>& ranks, const uint64_t* in, uint64_t* out, size_t n) override {
+        MPI_Allreduce(in, out, static_cast<int>(n), MPI_UINT64_T, MPI_MIN, comm(ranks));
+    }
+    std::unique_ptr<Request> post_allreduce_min(const uint64_t* in, uint64_t* out, size_t n) override {
+        return post_allreduce_min(MPI_COMM_WORLD, in, out, n);
+    }
+    std::unique_ptr<Request> post_allreduce_min(const std::vector<int>& ranks,
+                                                const uint64_t* in, uint64_t* out, size_t n) override {
+        return post_allreduce_min(comm(ranks), in, out, n);
+    }
+    std::vector<int> node_ranks() override {
+        MPI_Comm node;
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank_, MPI_INFO_NULL, &node);
+        int n = 0;
+        MPI_Comm_size(node, &n);
+        std::vector<int> ranks(n);
+        MPI_Allgather(&rank_, 1, MPI_INT, ranks.data(), 1, MPI_INT, node);
+        MPI_Comm_free(&node);
+        std::sort(ranks.begin(), ranks.end());
+        return ranks;
+    }
+    void abort(int code) override { MPI_Abort(MPI_COMM_WORLD, code); }
+    void finalize() override {
+        for (auto& c : comms_) MPI_Comm_free(&c.second);
+        comms_.clear();
+        int done = 0;
+        MPI_Finalized(&done);
+        if (!done) MPI_Finalize();
+    }
+
+private:
+    struct Pending : Request {
+        MPI_Request req;
+        void wait() override { MPI_Wait(&req, MPI_STATUS_IGNORE); }
+    };
+    std::unique_ptr<Request> post_allreduce_min(MPI_Comm c, const uint64_t* in, uint64_t* out, size_t n) {
+        Pending* p = new Pending();
+        MPI_Iallreduce(in, out, static_cast<int>(n), MPI_UINT64_T, MPI_MIN, c, &p->req);
+        return std::unique_ptr<Request>(p);
+    }
+    // Communicator over exactly `ranks`, created once per rank set (MPI-3: collective over
+    // the participants only)
+    MPI_Comm comm(const std::vector<int>& ranks) {
+        if (static_cast<int>(ranks.size()) == size_) return MPI_COMM_WORLD;
+        auto it = comms_.find(ranks);
+        if (it == comms_.end()) {
+            MPI_Group world_group, group;
+            MPI_Comm c;
+            MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+            MPI_Group_incl(world_group, int(ranks.size()), ranks.data(), &group);
+            MPI_Comm_create_group(MPI_COMM_WORLD, group, 0, &c);
+            MPI_Group_free(&group);
+            MPI_Group_free(&world_group);
+            it = comms_.insert(std::make_pair(ranks, c)).first;
+        }
+        return it->second;
+    }
+    int rank_, size_;
+    std::map<std::vector<int>, MPI_Comm> comms_;
+};
+
+inline HostCoordinator& HostCoordinator::get() {
+    std::unique_ptr<HostCoordinator>& c = slot();
+    if (!c) c.reset(new MpiCoordinator());
+    return *c;
+}
+
+// Timeline tracing in the Chrome / Perfetto JSON format, for looking at host time under
+// load, where Debug prints (synchronous per-rank I/O) would perturb it. Off unless
+// Tracer::enable(path) is called on every rank before MeshDevice::open. Each thread
+// appends timestamped complete events to its own buffer, with no lock or I/O. At close(),
+// every rank writes `path`.rank<r> and rank 0 merges the parts it can see into `path`:
+// one process per rank, with one track per host thread and one per local device.
+// Timestamps count from a barrier at open, so cross-host skew (e.g. arrival at wait()'s
+// barrier) is visible to within the exit skew of that barrier.
+class Tracer {
+public:
+    enum : uint32_t { kThisThread = ~0u, kDeviceTrack = 1u << 20 }; // Device tracks: + root local index
+
+    // Names and argument names must be string literals: events store the pointers
+    struct Event {
+        const char* name;
+        const char* arg_name[2];
+        uint64_t    arg[2];
+        int64_t     begin, end; // ns since the epoch
+        uint32_t    track;
+    };
+
+    static void enable(const std::string& path) {
+        instance().path_ = path;
+        instance().on_.store(true, std::memory_order_relaxed);
+    }
+    static bool on() { return instance().on_.load(std::memory_order_relaxed); }
+    static int64_t now() {
+        return int64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count()) - instance().epoch_;
+    }
+
+    static void record(const char* name, int64_t begin, int64_t end, uint32_t track = kThisThread,
+                       const char* a0 = nullptr, uint64_t v0 = 0, const char* a1 = nullptr, uint64_t v1 = 0) {
+        Buffer& b = buffer();
+        Event& e = b.next();
+        e.name = name;
+        e.arg_name[0] = a0; e.arg[0] = v0;
+        e.arg_name[1] = a1; e.arg[1] = v1;
+        e.begin = begin;
+        e.end = end;
+        e.track = track == kThisThread ? b.tid : track;
+    }
+
+    // Times its scope on the calling thread's track (or `track`); one branch when off
+    class Span {
+    public:
+        explicit Span(const char* name, uint32_t track = kThisThread)
+            : name_(on() ? name : nullptr), track_(track), begin_(name_ ? now() : 0) {}
+        ~Span() { if (name_) record(name_, begin_, now(), track_, args_[0], values_[0], args_[1], values_[1]); }
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+        Span& arg(const char* name, uint64_t value) {
+            const int i = args_[0] ? 1 : 0;
+            args_[i] = name;
+            values_[i] = value;
+            return *this;
+        }
+
+    private:
+        const char* name_;
+        uint32_t    track_;
+        int64_t     begin_;
+        const char* args_[2] = { nullptr, nullptr };
+        uint64_t    values_[2] = { 0, 0 };
+    };
+
+    // Track names in the merged trace (call when on(); not on hot paths)
+    static void name_thread(const std::string& name) { buffer().name = name; }
+    static void name_track(uint32_t track, const std::string& name) {
+        std::lock_guard<std::mutex> lock(instance().mu_);
+        instance().tracks_[track] = name;
+    }
+    static void name_process(const std::string& name) { instance().process_ = name; }
+
+    // Collective (MeshDevice::open): the common time base. The second barrier starts with
+    // the ranks already close together, so its exit is the tighter reference.
+    static void align() {
+        HostCoordinator& coord = HostCoordinator::get();
+        coord.barrier();
+        coord.barrier();
+        instance().epoch_ = 0;
+        instance().epoch_ = now();
+        if (buffer().name.empty()) name_thread("host");
+    }
+
+    // Collective (MeshDevice::close), once every thread that recorded has stopped
+    static void write(int rank, int world) {
+        Tracer& t = instance();
+        const std::string part = t.path_ + ".rank" + std::to_string(rank);
+        {
+            std::ofstream out(part.c_str());
+            out << "{\"ph\":\"M\",\"pid\":" << rank << ",\"name\":\"process_name\",\"args\":{\"name\":\""
+                << (t.process_.empty() ? "rank " + std::to_string(rank) : t.process_) << "\"}}\n"
+                << "{\"ph\":\"M\",\"pid\":" << rank << ",\"name\":\"process_sort_index\",\"args\":{\"sort_index\":" << rank << "}}\n";
+            for (const auto& b : t.buffers_) {
+                out << "{\"ph\":\"M\",\"pid\":" << rank << ",\"tid\":" << b->tid << ",\"name\":\"thread_name\",\"args\":{\"name\":\""
+                    << (b->name.empty() ? "thread " + std::to_string(b->tid) : b->name) << "\"}}\n";
+            }
+            for (const auto& k : t.tracks_) {
+                out << "{\"ph\":\"M\",\"pid\":" << rank << ",\"tid\":" << k.first << ",\"name\":\"thread_name\",\"args\":{\"name\":\""
+                    << k.second << "\"}}\n"
+                    << "{\"ph\":\"M\",\"pid\":" << rank << ",\"tid\":" << k.first << ",\"name\":\"thread_sort_index\",\"args\":{\"sort_index\":"
+                    << k.first << "}}\n";
+            }
+            char ts[64];
+            for (const auto& b : t.buffers_) {
+                for (size_t c = 0; c < b->chunks.size(); ++c) {
+                    const size_t n = c + 1 == b->chunks.size() ? b->used : size_t(kChunk);
+                    for (size_t i = 0; i < n; ++i) {
+                        const Event& e = b->chunks[c][i];
+                        std::snprintf(ts, sizeof(ts), "\"ts\":%.3f,\"dur\":%.3f", e.begin * 1e-3, (e.end - e.begin) * 1e-3);
+                        out << "{\"ph\":\"X\",\"pid\":" << rank << ",\"tid\":" << e.track << ",\"name\":\"" << e.name << "\"," << ts;
+                        if (e.arg_name[0]) {
+                            out << ",\"args\":{\"" << e.arg_name[0] << "\":" << e.arg[0];
+                            if (e.arg_name[1]) out << ",\"" << e.arg_name[1] << "\":" << e.arg[1];
+                            out << "}";
+                        }
+                        out << "}\n";
+                    }
+                }
+            }
+        }
+        HostCoordinator::get().barrier();
+        if (rank == 0) t.merge(world);
+        t.on_.store(false, std::memory_order_relaxed);
+    }
+
+private:
+    enum { kChunk = 4096 };
+    // One thread's events; only that thread appends, write() reads it after the thread stopped
+    struct Buffer {
+        uint32_t tid;
+        std::string name;
+        std::vector<std::unique_ptr<Event[]> > chunks;
+        size_t used = kChunk;
+        Event& next() {
+            if (used == kChunk) { chunks.emplace_back(new Event[kChunk]); used = 0; }
+            return chunks.back()[used++];
+        }
+    };
+
+    static Buffer& buffer() {
+        static thread_local Buffer* mine = nullptr;
+        if (!mine) { // First event of this thread
+            Tracer& t = instance();
+            std::lock_guard<std::mutex> lock(t.mu_);
+            t.buffers_.emplace_back(new Buffer());
+            mine = t.buffers_.back().get();
+            mine->tid = uint32_t(t.buffers_.size() - 1);
+        }
+        return *mine;
+    }
+
+    // Rank 0: concatenate the parts into one JSON trace, removing the parts it read
+    void merge(int world) const {
+        std::ofstream out(path_.c_str());
+        out << "{\"traceEvents\":[\n";
+        bool first = true;
+        int missing = 0;
+        for (int r = 0; r < world; ++r) {
+            const std::string part = path_ + ".rank" + std::to_string(r);
+            std::ifstream in(part.c_str());
+            if (!in) { ++missing; continue; }
+            std::string line;
+            while (std::getline(in, line)) {
+                if (line.empty()) continue;
+                out << (first ? "" : ",\n") << line;
+                first = false;
+            }
+            in.close();
+            std::remove(part.c_str());
+        }
+        out << "\n]}\n";
+        if (missing) {
+            std::cerr << "Warning: trace " << path_ << ": " << missing << " rank part(s) not visible to rank 0, left as "
+                      << path_ << ".rank<r>\n";
+        }
+    }
+
+    std::atomic<bool> on_{false};
+    int64_t     epoch_ = 0; // Set by align() before any other thread starts recording
+    std::string path_;
+    std::string process_;
+    std::mutex  mu_;        // Registration only
+    std::vector<std::unique_ptr<Buffer> > buffers_;
+    std::map<uint32_t, std::string> tracks_;
+    static Tracer& instance() { static Tracer t; return t; }
+};
+
+// How ranks are assigned to host submeshes (MeshDevice::open). The host grid is the mesh
+// cut into host submeshes; every rank serves one slot of it.
+//   ROW_MAJOR: rank r serves slot r, row-major (default)
+//   NODE:      the ranks of one machine (HostCoordinator::node_ranks) get one compact tile
+//              of the grid and consecutive machines neighbouring tiles (serpentine), so
+//              most submesh neighbours share a machine and the rest are machines apart by one
+//   FILE:      mesh description `file`, one "host_x host_y hostname" line per slot (# starts
+//              a comment); the ranks on each machine take its slots in file order. A
+//              rank's hostname is $MESH_HOSTNAME if set, else gethostname().
+struct PlacementConfig {
+    enum class Policy { ROW_MAJOR, NODE, FILE };
+    Policy      policy = Policy::ROW_MAJOR;
+    std::string file;
+};
+
+// The host grid (which rank serves which host submesh, see PlacementConfig) and the rank
+// groups it implies: the host row and column of this rank, its physical node, and the
+// ranks whose submesh intersects any DeviceRange. Groups are cached, so the references
+// stay valid; operations along one mesh axis then involve O(sqrt(world)) ranks, not all.
+class HostGrid {
+public:
+    static HostGrid& get() { static HostGrid g; return g; }
+
+    // Collective (node discovery, placement); called by MeshDevice once the shapes are
+    // validated. Every rank derives the same placement.
+    void configure(Shape mesh_shape, Shape host_submesh_shape, int rank,
+                   const PlacementConfig& placement = PlacementConfig(),
+                   const Topology& topology = Topology()) {
+        std::lock_guard<std::mutex> lock(mu_);
+        mesh_ = mesh_shape;
+        topology_ = topology;
+        submesh_ = host_submesh_shape;
+        hosts_ = Shape(mesh_shape.x / host_submesh_shape.x, mesh_shape.y / host_submesh_shape.y);
+        node_ = HostCoordinator::get().node_ranks();
+        const size_t n = size_t(hosts_.x) * hosts_.y;
+        switch (placement.policy) {
+            case PlacementConfig::Policy::ROW_MAJOR:
+                slot_rank_.resize(n);
+                for (size_t i = 0; i < n; ++i) slot_rank_[i] = int(i);
+                break;
+            case PlacementConfig::Policy::NODE: slot_rank_ = place_by_node(); break;
+            case PlacementConfig::Policy::FILE: slot_rank_ = place_from_file(placement.file); break;
+        }
+        rank_slot_.assign(n, 0);
+        for (size_t i = 0; i < n; ++i) rank_slot_[size_t(slot_rank_[i])] = uint32_t(i);
+        host_ = host_of(rank);
+        groups_.clear();
+        configured_ = true;
+    }
+    bool  configured() const { return configured_; }
+    Shape mesh_shape() const { return mesh_; }
+    Shape hosts() const { return hosts_; } // Host grid dimensions
+    Shape host()  const { return host_; }  // This rank's host coordinates
+    Shape host_of(int rank) const { uint32_t i = rank_slot_[size_t(rank)]; return Shape(i % hosts_.x, i / hosts_.x); }
+    int   rank_at(Shape host) const { return slot_rank_[size_t(host.y) * hosts_.x + host.x]; }
+    // Rank of the host `step` submeshes from `host` along `axis`, wrapping where the mesh
+    // does (a torus wraps its host grid too); -1 past an open edge
+    int   neighbor_rank(Shape host, Axis axis, int32_t step) const {
+        Shape n;
+        return topology_.neighbor(hosts_, host, axis, step, n) ? rank_at(n) : -1;
+    }
+    int   neighbor_rank(Axis axis, int32_t step) const { return neighbor_rank(host_, axis, step); }
+    const Topology& topology() const { return topology_; }
+
+    const std::vector<int>& row()    { return ranks_of(DeviceRange::row(host_.y * submesh_.y, mesh_)); }
+    const std::vector<int>& column() { return ranks_of(DeviceRange::column(host_.x * submesh_.x, mesh_)); }
+    const std::vector<int>& node() const { return node_; }
+
+    // Ranks whose host submesh intersects `devices`, ascending (empty if none)
+    const std::vector<int>& ranks_of(const DeviceRange& devices) {
+        std::lock_guard<std::mutex> lock(mu_);
+        DeviceRange d = devices.intersect(DeviceRange::full(mesh_));
+        Range hx, hy;
+        if (!d.empty()) {
+            hx = Range(d.x_range.start / submesh_.x, (d.x_range.end + submesh_.x - 1) / submesh_.x);
+            hy = Range(d.y_range.start / submesh_.y, (d.y_range.end + submesh_.y - 1) / submesh_.y);
+        }
+        uint64_t key = (uint64_t(hx.start) << 48) | (uint64_t(hx.end) << 32) | (uint64_t(hy.start) << 16) | hy.end;
+        auto it = groups_.find(key);
+        if (it != groups_.end()) return it->second;
+        std::vector<int>& ranks = groups_[key];
+        for (uint32_t y = hy.start; y < hy.end; ++y)
+            for (uint32_t x = hx.start; x < hx.end; ++x) ranks.push_back(slot_rank_[size_t(y) * hosts_.x + x]);
+        std::sort(ranks.begin(), ranks.end());
+        return ranks;
+    }
+    // Validation group for an op on `devices` of a `mesh`-shaped target: null (all ranks)
+    // unless the grid is configured for that mesh
+    const std::vector<int>* group_of(const DeviceRange& devices, Shape mesh) {
+        if (!configured_ || mesh.x != mesh_.x || mesh.y != mesh_.y) return nullptr;
+        return &ranks_of(devices);
+    }
+
+private:
+    HostGrid() {}
+
+    // Every rank's n words, rank-major: an allgather built on allreduce_min
+    static std::vector<uint64_t> gather(const uint64_t* mine, size_t n) {
+        HostCoordinator& c = HostCoordinator::get();
+        std::vector<uint64_t> in(size_t(c.size()) * n, ~uint64_t(0)), out(in.size());
+        std::copy(mine, mine + n, in.begin() + size_t(c.rank()) * n);
+        c.allreduce_min(in.data(), out.data(), in.size());
+        return out;
+    }
+    // i-th cell of a width-wide grid walked row by row, alternating direction
+    static Shape serpentine(size_t i, uint32_t width) {
+        uint32_t y = uint32_t(i / width), x = uint32_t(i % width);
+        return Shape(y % 2 ? width - 1 - x : x, y);
+    }
+
+    std::vector<int> place_by_node() const {
+        // Machines in order of their lowest rank, each with its ranks ascending
+        uint64_t leader = uint64_t(node_.front());
+        std::vector<uint64_t> leaders = gather(&leader, 1);
+        std::vector<std::vector<int> > nodes;
+        std::map<uint64_t, size_t> index;
+        bool uniform = true;
+        for (size_t r = 0; r < leaders.size(); ++r) {
+            auto it = index.insert(std::make_pair(leaders[r], nodes.size())).first;
+            if (it->second == nodes.size()) nodes.push_back(std::vector<int>());
+            nodes[it->second].push_back(int(r));
+        }
+        for (const auto& m : nodes) uniform = uniform && m.size() == nodes.front().size();
+
+        // Squarest tile of k slots that tiles the grid (none if machines differ in size)
+        const uint32_t k = uint32_t(nodes.front().size());
+        uint32_t tx = 0, ty = 0;
+        for (uint32_t x = 1; uniform && x <= k; ++x) {
+            if (k % x || hosts_.x % x || hosts_.y % (k / x)) continue;
+            if (!tx || std::max(x, k / x) < std::max(tx, ty)) { tx = x; ty = k / x; }
+        }
+        std::vector<int> slots(size_t(hosts_.x) * hosts_.y);
+        if (tx) {
+            for (size_t t = 0; t < nodes.size(); ++t) {
+                Shape tile = serpentine(t, hosts_.x / tx);
+                for (uint32_t i = 0; i < k; ++i) {
+                    uint32_t x = tile.x * tx + i % tx, y = tile.y * ty + i / tx;
+                    slots[size_t(y) * hosts_.x + x] = nodes[t][i];
+                }
+            }
+            return slots;
+        }
+        // Uneven machines: one serpentine walk over the grid keeps each machine's ranks
+        // contiguous and every step between neighbours
+        size_t i = 0;
+        for (const auto& m : nodes) {
+            for (int r : m) { Shape h = serpentine(i++, hosts_.x); slots[size_t(h.y) * hosts_.x + h.x] = r; }
+        }
+        return slots;
+    }
+
+    std::vector<int> place_from_file(const std::string& path) const {
+        enum { kNameWords = 8 }; // Hostnames compared on their first 63 bytes
+        uint64_t mine[kNameWords] = {};
+        std::string me = hostname().substr(0, 8 * kNameWords - 1);
+        std::memcpy(mine, me.data(), me.size());
+        std::vector<uint64_t> names = gather(mine, kNameWords);
+        std::map<std::string, std::deque<int> > unplaced; // Machine -> its ranks not yet placed
+        for (size_t r = 0; r * kNameWords < names.size(); ++r) {
+            const char* name = reinterpret_cast<const char*>(&names[r * kNameWords]);
+            unplaced[std::string(name, strnlen(name, 8 * kNameWords))].push_back(int(r));
+        }
+
+        std::ifstream in(path.c_str());
+        if (!in) fail("cannot open mesh description '" + path + "'");
+        std::vector<int> slots(size_t(hosts_.x) * hosts_.y, -1);
+        std::string line;
+        for (size_t lineno = 1; std::getline(in, line); ++lineno) {
+            std::istringstream fields(line.substr(0, line.find('#')));
+            uint32_t x, y;
+            std::string host;
+            if (!(fields >> x)) continue; // Blank or comment
+            std::string where = path + ":" + std::to_string(lineno) + ": ";
+            if (!(fields >> y >> host) || x >= hosts_.x || y >= hosts_.y) {
+                fail(where + "expected 'host_x host_y hostname' inside the " + mesh::to_string(hosts_) + " host grid");
+            }
+            int& slot = slots[size_t(y) * hosts_.x + x];
+            auto it = unplaced.find(host.substr(0, 8 * kNameWords - 1));
+            if (slot >= 0) fail(where + "host slot described twice");
+            if (it == unplaced.end() || it->second.empty()) fail(where + "no unplaced rank runs on '" + host + "'");
+            slot = it->second.front();
+            it->second.pop_front();
+        }
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (slots[i] < 0) fail(path + ": no host for slot (" + std::to_string(i % hosts_.x) + ", " + std::to_string(i / hosts_.x) + ")");
+        }
+        return slots;
+    }
+    static std::string hostname() {
+        if (const char* h = std::getenv("MESH_HOSTNAME")) return h;
+#if defined(__unix__) || defined(__APPLE__)
+        char buf[256] = {};
+        if (gethostname(buf, sizeof(buf) - 1) == 0) return buf;
+#endif
+        return "localhost";
+    }
+    // Every rank reads the same file, so every rank fails the same way
+    static void fail(const std::string& what) {
+        if (HostCoordinator::get().rank() == 0) std::cerr << "Error: placement: " << what << "\n";
+        HostCoordinator::get().abort(1);
+    }
+
+    std::mutex mu_;
+    bool  configured_ = false;
+    Shape mesh_, submesh_, hosts_, host_;
+    Topology topology_;
+    std::vector<int> node_;
+    std::vector<int> slot_rank_;      // Host slot (row-major) -> rank
+    std::vector<uint32_t> rank_slot_; // Rank -> host slot
+    std::map<uint64_t, std::vector<int> > groups_; // Host rectangle -> ranks; entries never move
+};
+
 struct Validation {
-    static void enabled(bool on) { instance().on_ = on; }
-    static bool on()             { return instance().on_; }
+    // IMMEDIATE:   one blocking collective per lockstep op (default)
+    // DEFERRED:    ops folded into a running digest, reconciled at checkpoints
+    // NONBLOCKING: one nonblocking allreduce per op, completed only when its result is needed
+    enum class Mode { IMMEDIATE, DEFERRED, NONBLOCKING };
+
+    static void enabled(bool on) { flag() = on; }
+    // Constant false when compiled out; otherwise a plain load (no singleton guard)
+    static bool on()             { return BuildConfig::validation && flag(); }
+
+    // Deferred mode: instead of one collective per lockstep op, ops are folded in order
+    // into a running digest that is reconciled with a single collective every
+    // `every_n_ops` ops (0 = only at checkpoints: MeshDevice::wait and close).
+    static void defer(uint64_t every_n_ops) { instance().mode_ = Mode::DEFERRED; instance().every_ = every_n_ops; }
+    // Nonblocking mode: the check for a MeshWorkload is completed just before it is
+    // dispatched, other checks at MeshDevice::wait and close.
+    static void nonblocking()               { instance().mode_ = Mode::NONBLOCKING; }
+    static void immediate()                 { instance().mode_ = Mode::IMMEDIATE; }
+    static Mode mode()                      { return instance().mode_; }
+    static bool blocking()                  { return instance().mode_ == Mode::IMMEDIATE; }
+    static uint64_t ops()                   { return instance().ops_; }
+    // Scoped checks (immediate and nonblocking modes): an op that only involves some hosts,
+    // e.g. a workload targeting one mesh row, is checked among just those ranks (see
+    // HostGrid). Cheaper at scale, but a rank that diverges in the op's footprint itself
+    // may then hang in a mismatched collective instead of being reported. Off by default.
+    static void scoped(bool on)             { instance().scoped_ = on; }
+    static bool scoped()                    { return instance().scoped_; }
+
+    // In-flight nonblocking check of one op; buffers must stay put until completion
+    struct Check {
+        uint64_t    in[2], out[2];
+        std::unique_ptr<HostCoordinator::Request> req; // Null once the result is in out
+        uint64_t    op;
+        const char* what;
+        int         reporter; // Rank that prints a divergence (lowest of the group)
+        bool        done;
+    };
+    typedef std::shared_ptr<Check> CheckHandle;
+
+    // True iff every rank (of `group`, null = all) passed the same value (safe for any world size)
+    static bool ranks_agree(uint64_t v, const std::vector<int>* group = nullptr) {
+        Tracer::Span span("validate");
+        if (group) span.arg("ranks", group->size());
+        uint64_t in[2] = { v, ~v }, out[2];
+        if (group) HostCoordinator::get().allreduce_min(*group, in, out, 2);
+        else       HostCoordinator::get().allreduce_min(in, out, 2);
+        return out[0] == ~out[1]; // min == max
+    }
+
+    // Record one lockstep-relevant op. Immediate mode checks it now; the other modes
+    // only record/post it and report divergence later. Every mode aborts on a divergence.
+    // `group`: the ranks the op involves (honoured when scoped(); null = all). Ranks
+    // outside it only count the op.
+    static void check(uint64_t op_hash, const char* what, const std::vector<int>* group = nullptr) {
+        Validation& v = instance();
+        group = v.effective(group);
+        switch (v.mode_) {
+            case Mode::IMMEDIATE: {
+                const uint64_t op = v.ops_++;
+                if (group && (group->size() == 1 || !v.member(*group))) return; // Nothing to compare
+                if (!ranks_agree(op_hash, group)) report_divergence(op, what, "immediate", group ? group->front() : 0);
+                return;
+            }
+            case Mode::NONBLOCKING:
+                post(op_hash, what, group);
+                return;
+            case Mode::DEFERRED:
+                break;
+        }
+        ++v.ops_;
+        v.digest_ = mix64(v.digest_ ^ op_hash);
+        v.log_.push_back({op_hash, what});
+        if (v.every_ && v.log_.size() >= v.every_) checkpoint("interval");
+    }
+
+    // Nonblocking mode: start the agreement check for one op and return its handle
+    // (null when this rank is outside `group`)
+    static CheckHandle post(uint64_t op_hash, const char* what, const std::vector<int>* group = nullptr) {
+        Validation& v = instance();
+        group = v.effective(group);
+        if (group && (group->size() == 1 || !v.member(*group))) { ++v.ops_; return CheckHandle(); }
+        CheckHandle c = std::make_shared<Check>();
+        c->in[0] = op_hash; c->in[1] = ~op_hash;
+        c->op = v.ops_++;
+        c->what = what;
+        c->reporter = group ? group->front() : 0;
+        c->done = false;
+        if (group) c->req = HostCoordinator::get().post_allreduce_min(*group, c->in, c->out, 2);
+        else       c->req = HostCoordinator::get().post_allreduce_min(c->in, c->out, 2);
+        while (!v.outstanding_.empty() && v.outstanding_.front()->done) v.outstanding_.pop_front();
+        v.outstanding_.push_back(c);
+        return c;
+    }
+
+    // Wait for one posted check; aborts if the ranks disagreed
+    static void complete(const CheckHandle& c, const char* where) {
+        if (!c || c->done) return;
+        if (c->req) {
+            Tracer::Span span("validate wait");
+            span.arg("op", c->op);
+            c->req->wait();
+        }
+        c->req.reset();
+        c->done = true;
+        if (c->out[0] != ~c->out[1]) report_divergence(c->op, c->what, where, c->reporter);
+    }
+
+    // Collective: settle everything recorded since the last checkpoint (deferred and
+    // nonblocking modes). On mismatch reports the first diverging op index and aborts.
+    static void checkpoint(const char* where) {
+        Validation& v = instance();
+        if (!on()) return;
+        if (v.mode_ == Mode::NONBLOCKING) {
+            for (const auto& c : v.outstanding_) complete(c, where);
+            v.outstanding_.clear();
+            return;
+        }
+        if (v.mode_ != Mode::DEFERRED || v.log_.empty()) return;
+        int rank = HostCoordinator::get().rank();
+        Tracer::Span span("validate checkpoint");
+        span.arg("ops", v.log_.size());
+
+        const uint64_t n = v.log_.size();
+        uint64_t in[4] = { v.digest_, ~v.digest_, n, ~n }, out[4];
+        HostCoordinator::get().allreduce_min(in, out, 4);
+        if (out[0] == ~out[1]) {
+            if (Debug::should_print(rank)) {
+                std::cout << "[rank " << rank << "] Validation: checkpoint at " << where << ": ops ["
+                          << v.checked_ << ".." << v.ops_ << ") OK\n";
+            }
+            v.checked_ = v.ops_;
+            v.log_.clear();
+            return;
+        }
+
+        // Slow path, only on failure: compare the per-op log to find the first divergence
+        uint64_t first = out[2];                  // Shortest log if counts differ
+        if (out[2] == ~out[3]) {
+            std::vector<uint64_t> ops(2 * n), agreed(2 * n);
+            for (size_t i = 0; i < n; ++i) { ops[2 * i] = v.log_[i].hash; ops[2 * i + 1] = ~v.log_[i].hash; }
+            HostCoordinator::get().allreduce_min(ops.data(), agreed.data(), 2 * n);
+            for (first = 0; first < n && agreed[2 * first] == ~agreed[2 * first + 1]; ++first) {}
+        }
+        report_divergence(v.checked_ + first, first < n ? v.log_[first].what : nullptr, where);
+    }
+
 private:
-    bool on_ = true;
+    static void report_divergence(uint64_t op, const char* what, const char* where, int reporter = 0) {
+        int rank = HostCoordinator::get().rank();
+        if (rank == reporter) {
+            std::cerr << "Error: ranks diverged at lockstep op #" << op
+                      << (what ? std::string(" (") + what + ")" : std::string())
+                      << ", detected at " << where << "\n";
+        }
+        HostCoordinator::get().abort(1);
+    }
+
+    // Deferred mode folds every op into the global digest, so groups only apply to the others
+    const std::vector<int>* effective(const std::vector<int>* group) const {
+        return scoped_ && mode_ != Mode::DEFERRED ? group : nullptr;
+    }
+    static bool member(const std::vector<int>& group) {
+        return std::binary_search(group.begin(), group.end(), HostCoordinator::get().rank());
+    }
+
+    struct Op { uint64_t hash; const char* what; };
+    bool     scoped_ = false;
+    Mode     mode_ = Mode::IMMEDIATE;
+    uint64_t every_ = 0;
+    uint64_t ops_ = 0;     // Lockstep ops recorded so far
+    uint64_t checked_ = 0; // Ops covered by the last successful checkpoint
+    uint64_t digest_ = 0;  // Running digest of all recorded ops, in order
+    std::vector<Op> log_;  // Ops since the last checkpoint, for locating a divergence
+    std::deque<CheckHandle> outstanding_; // Nonblocking checks, in post order
     static Validation& instance() { static Validation v; return v; }
+    static bool& flag() { static bool on = true; return on; } // Constant-initialized
+};
+
+// Straggler detection at the global sync points. Each rank times its arrival at every
+// MeshDevice::wait() (once its pushes completed locally), counted from the previous
+// wait's return: its host work for the step. Every `every` waits, the window's totals are reduced with a single allreduce_min on the
+// coordinator, which also serves as that wait's barrier, so monitoring costs no extra
+// collective. Every rank gets the same Report: the slowest and fastest rank with their
+// arrival times, plus a per-rank tally of windows in which each rank was slowest.
+// Lockstep: enable with the same `every` on all ranks, between the same two waits.
+class Stragglers {
+public:
+    struct Report {
+        uint64_t window = 0;               // Reductions so far
+        uint64_t syncs = 0;                // wait()s covered by this one
+        double   slowest_us = 0, fastest_us = 0;
+        int      slowest_rank = -1, fastest_rank = -1;
+        double   worst_step_us = 0;        // Longest single arrival of any rank, and whose
+        int      worst_step_rank = -1;
+        double   local_us = 0;             // This rank's arrival time over the window
+        double   skew_us() const { return slowest_us - fastest_us; }
+    };
+
+    // every = 0 turns monitoring off. log: rank 0 prints each window's report.
+    static void enable(uint64_t every, bool log = false) {
+        Stragglers& s = instance();
+        s.every_ = every;
+        s.log_ = log;
+        s.reset_window();
+        s.last_exit_ = now_us();
+    }
+    static bool on() { return instance().every_ != 0; }
+    static const Report& last() { return instance().report_; }
+    // Windows in which each rank was the slowest; identical on every rank
+    static const std::vector<uint64_t>& slowest_counts() { return instance().slowest_; }
+
+    // MeshDevice::wait, on entry: the end of this rank's step
+    static void arrive() {
+        Stragglers& s = instance();
+        if (!s.every_) return;
+        const uint64_t step = now_us() - s.last_exit_;
+        s.total_ += step;
+        s.worst_ = std::max(s.worst_, step);
+        ++s.syncs_;
+    }
+    // MeshDevice::wait, in place of the barrier: true if it reduced (and so synchronized)
+    static bool reduce() {
+        Stragglers& s = instance();
+        if (!s.every_ || s.syncs_ < s.every_) return false;
+        s.reduce_window();
+        return true;
+    }
+    // MeshDevice::wait, on return: the next step starts
+    static void depart() {
+        Stragglers& s = instance();
+        if (s.every_) s.last_exit_ = now_us();
+    }
+
+private:
+    // A key orders by time, then by rank. min over keys gives the fastest rank, and min
+    // over complemented keys the slowest: one word per statistic, with no gather.
+    enum { kRankBits = 24 };
+    static uint64_t key(uint64_t us, int rank) {
+        return (std::min<uint64_t>(us, (uint64_t(1) << (64 - kRankBits)) - 1) << kRankBits) | uint64_t(rank);
+    }
+    static double key_us(uint64_t k) { return double(k >> kRankBits); }
+    static int    key_rank(uint64_t k) { return int(k & ((uint64_t(1) << kRankBits) - 1)); }
+    static uint64_t now_us() {
+        return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void reduce_window() {
+        HostCoordinator& coord = HostCoordinator::get();
+        const int rank = coord.rank();
+        Tracer::Span span("straggler reduce");
+        uint64_t in[3] = { key(total_, rank), ~key(total_, rank), ~key(worst_, rank) }, out[3];
+        coord.allreduce_min(in, out, 3);
+        out[1] = ~out[1];
+        out[2] = ~out[2];
+
+        report_.window++;
+        report_.syncs = syncs_;
+        report_.fastest_us = key_us(out[0]);
+        report_.fastest_rank = key_rank(out[0]);
+        report_.slowest_us = key_us(out[1]);
+        report_.slowest_rank = key_rank(out[1]);
+        report_.worst_step_us = key_us(out[2]);
+        report_.worst_step_rank = key_rank(out[2]);
+        report_.local_us = double(total_);
+        if (slowest_.size() != size_t(coord.size())) slowest_.assign(coord.size(), 0);
+        ++slowest_[report_.slowest_rank];
+        span.arg("slowest_rank", uint64_t(report_.slowest_rank)).arg("skew_us", uint64_t(report_.skew_us()));
+
+        if (log_ && rank == 0) {
+            std::cout << "[stragglers] window " << report_.window << " (" << syncs_ << " wait(s)): slowest rank "
+                      << report_.slowest_rank << " " << report_.slowest_us << " us, fastest rank "
+                      << report_.fastest_rank << " " << report_.fastest_us << " us, skew " << report_.skew_us()
+                      << " us; worst step rank " << report_.worst_step_rank << " " << report_.worst_step_us << " us\n";
+        }
+        reset_window();
+    }
+    void reset_window() { total_ = worst_ = syncs_ = 0; }
+
+    uint64_t every_ = 0;
+    bool     log_ = false;
+    uint64_t last_exit_ = 0; // us
+    uint64_t total_ = 0, worst_ = 0, syncs_ = 0; // Current window
+    Report   report_;
+    std::vector<uint64_t> slowest_;
+    static Stragglers& instance() { static Stragglers s; return s; }
+};
+
+// Host-side dispatch configuration, passed to MeshDevice::open
+struct DispatchConfig {
+    // Worker threads draining local DeviceCQs in dispatch_pending; 0 = serial on the calling thread
+    size_t threads = 0;
+    // Optional core for each worker (worker i -> cpus[i % size]), e.g. the cores of the
+    // NUMA node nearest the devices' PCIe root. Empty = no pinning.
+    std::vector<int> cpus;
+    // Async MeshCQ: pushes are dispatched by a background thread, at most this many
+    // pushes may be in flight before push() blocks. 0 = synchronous MeshCQ.
+    size_t async_depth = 0;
+    // Workload structures kept pre-encoded per MeshCQ (see ProgramCache); 0 = encode every push
+    size_t program_cache = 64;
+    // Slots of each local DeviceCQ ring (rounded up to a power of two). When one is full,
+    // enqueueing waits for the dispatch thread (async) or drains it in place (sync).
+    size_t device_cq_entries = 1024;
+};
+
+// Local device bring-up at MeshDevice::open
+struct StartupConfig {
+    // Threads bringing up the local devices; 0 = one per device (bring-up mostly waits on
+    // the hardware, so it is not bounded by cores); 1 = serial on the opening thread
+    size_t threads = 0;
+    // Bring the devices up in the background while the host finishes its coordinator
+    // wire-up (node discovery, placement, row/column communicators) and dispatch setup,
+    // so open() takes about max(wire-up, slowest device) instead of their sum
+    bool overlap = true;
+    // Extra per-device step after Device::bring_up, run on the startup threads
+    std::function<void(Device&)> device_init;
+};
+
+// Fixed set of host threads that MeshDevice uses to drain local DeviceCQs in parallel.
+// parallel_for hands out task indices through a shared atomic cursor, so idle workers
+// keep taking the next unclaimed task while others are still busy on long queues.
+class WorkerPool {
+public:
+    // `name`: trace name of the workers, numbered from 0
+    explicit WorkerPool(const DispatchConfig& cfg, const std::string& name = "dispatch worker") : name_(name) {
+        workers_.reserve(cfg.threads);
+        for (size_t i = 0; i < cfg.threads; ++i) {
+            workers_.emplace_back(&WorkerPool::worker_loop, this, i);
+            if (!cfg.cpus.empty()) pin(workers_.back(), cfg.cpus[i % cfg.cpus.size()]);
+        }
+    }
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : workers_) t.join();
+    }
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t size() const { return workers_.size(); }
+
+    // Runs task(i) for every i in [0, count) on the workers and the calling thread.
+    // Returns once all tasks have finished.
+    void parallel_for(size_t count, const std::function<void(size_t)>& task) {
+        if (count == 0) return;
+        std::shared_ptr<Job> job = std::make_shared<Job>(task, count);
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            job_ = job;
+            ++generation_;
+        }
+        wake_.notify_all();
+        drain(*job);
+        std::unique_lock<std::mutex> lock(mu_);
+        done_.wait(lock, [&] { return job->remaining == 0; });
+        job_.reset();
+    }
+
+private:
+    // One parallel_for call; workers that wake late find the cursor exhausted
+    struct Job {
+        Job(const std::function<void(size_t)>& t, size_t n) : task(t), count(n), next(0), remaining(n) {}
+        const std::function<void(size_t)>& task;
+        const size_t        count;
+        std::atomic<size_t> next;
+        size_t              remaining; // Guarded by WorkerPool::mu_
+    };
+
+    static void pin(std::thread& t, int cpu) {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+#else
+        (void)t; (void)cpu; // Affinity is best-effort; not supported on this platform
+#endif
+    }
+
+    void drain(Job& job) {
+        size_t finished = 0;
+        for (size_t i = job.next.fetch_add(1); i < job.count; i = job.next.fetch_add(1)) {
+            job.task(i);
+            ++finished;
+        }
+        if (finished == 0) return;
+        std::lock_guard<std::mutex> lock(mu_);
+        job.remaining -= finished;
+        if (job.remaining == 0) done_.notify_all();
+    }
+
+    void worker_loop(size_t index) {
+        if (Tracer::on()) Tracer::name_thread(name_ + " " + std::to_string(index));
+        uint64_t seen = 0;
+        for (;;) {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lock(mu_);
+                wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen = generation_;
+                job = job_;
+            }
+            if (job) drain(*job);
+        }
+    }
+
+    std::string              name_;
+    std::vector<std::thread> workers_;
+    std::mutex               mu_;
+    std::condition_variable  wake_, done_;
+    std::shared_ptr<Job>     job_;
+    uint64_t                 generation_ = 0;
+    bool                     stop_ = false;
+};
+
+enum class BufferType { DRAM, L1 };
+
+inline const char* to_string(BufferType t) { return t == BufferType::DRAM ? "DRAM" : "L1"; }
+
+enum class DataType { UINT8, UINT16, BFLOAT16, UINT32, FLOAT32 };
+
+inline size_t element_size(DataType t) {
+    switch (t) {
+        case DataType::UINT8:    return 1;
+        case DataType::UINT16:
+        case DataType::BFLOAT16: return 2;
+        case DataType::UINT32:
+        case DataType::FLOAT32:  return 4;
+    }
+    return 1;
+}
+
+// How one tensor axis of a MeshBuffer maps onto the same axis of its owning mesh:
+// split into equal (last possibly shorter) slices, one per device, or replicated in full.
+enum class ShardMode { SHARDED, REPLICATED };
+
+// Tile layout of a tilized MeshBuffer or HostBuffer (see HostOps::tilize): tiles stored one after another
+// in row-major tile order; inside a tile, faces in row-major face order; inside a face,
+// elements row-major. Default: 32x32 tile of four 16x16 faces. face == tile gives plain tiles.
+struct TileShape {
+    uint32_t h = 32, w = 32;
+    uint32_t face_h = 16, face_w = 16;
+    size_t elements() const { return static_cast<size_t>(h) * w; }
 };
 
+enum class HostLayout { ROW_MAJOR, TILE };
+
+// Element type, memory type, sharding and layout of a MeshBuffer. The default (uint8,
+// DRAM, sharded along both axes, row-major) matches MeshDevice::allocate(Shape).
+// layout TILE: each device shard is stored in `tile`s (shards must be whole tiles), and
+// host_view() and transfers use the same layout.
+struct BufferSpec {
+    BufferType type   = BufferType::DRAM;
+    DataType   dtype  = DataType::UINT8;
+    ShardMode  x      = ShardMode::SHARDED;
+    ShardMode  y      = ShardMode::SHARDED;
+    HostLayout layout = HostLayout::ROW_MAJOR;
+    TileShape  tile;
+};
+
+// Rectangle of tensor elements, [x_range) columns x [y_range) rows, in global tensor coordinates
+struct TensorRegion {
+    Range x_range;
+    Range y_range;
+    uint32_t width()  const { return x_range.size(); }
+    uint32_t height() const { return y_range.size(); }
+    size_t   elements() const { return static_cast<size_t>(width()) * height(); }
+    bool     empty() const { return x_range.empty() || y_range.empty(); }
+};
+
+// Geometry of one memory type on every device. Buffers are interleaved page by page
+// across all banks and occupy the same bank-local address range in each bank.
+struct BankConfig {
+    uint32_t num_banks;
+    uint64_t bank_size;  // Bytes per bank
+    uint64_t base;       // First allocatable bank-local address (below is reserved)
+    uint64_t alignment;  // Of bank-local addresses and per-bank footprints
+    uint64_t page_size;  // Interleaving granularity
+};
+
+// Per-device memory layout used by MeshDevice::allocate (identical on every device of the mesh)
+struct AllocatorConfig {
+    BankConfig dram = { 12, 1ULL << 30, 0,         32, 2048 };
+    BankConfig l1   = { 64, 1ULL << 20, 128 << 10, 16, 2048 };
+};
+
+// Deterministic first-fit allocator over one bank-local address range.
+// Free blocks are kept address-ordered and coalesced on free, so the same sequence of
+// allocate/deallocate calls yields the same addresses on every rank.
+class BankAllocator {
+public:
+    explicit BankAllocator(const BankConfig& cfg) : cfg_(cfg) {
+        assert(cfg_.num_banks > 0 && cfg_.page_size > 0 && is_pow2(cfg_.alignment));
+        uint64_t start = align_up(cfg_.base);
+        if (start < cfg_.bank_size) free_[start] = cfg_.bank_size - start;
+    }
+
+    const BankConfig& config() const { return cfg_; }
+
+    // Bytes each bank holds for a buffer of `bytes`, interleaved page by page across all banks
+    uint64_t bank_footprint(uint64_t bytes) const {
+        uint64_t pages = (bytes + cfg_.page_size - 1) / cfg_.page_size;
+        uint64_t pages_per_bank = (pages + cfg_.num_banks - 1) / cfg_.num_banks;
+        return align_up(pages_per_bank * cfg_.page_size);
+    }
+
+    // Lowest-addressed block that fits; returns false when out of memory
+    bool allocate(uint64_t bytes, uint64_t& addr) {
+        uint64_t need = bank_footprint(bytes ? bytes : 1);
+        for (auto it = free_.begin(); it != free_.end(); ++it) {
+            if (it->second < need) continue;
+            addr = it->first;
+            uint64_t rest = it->second - need;
+            free_.erase(it);
+            if (rest) free_[addr + need] = rest;
+            used_[addr] = need;
+            return true;
+        }
+        return false;
+    }
+
+    void deallocate(uint64_t addr) {
+        auto u = used_.find(addr);
+        assert(u != used_.end() && "deallocate of an address that is not allocated");
+        if (u == used_.end()) return;
+        uint64_t start = addr, size = u->second;
+        used_.erase(u);
+
+        auto next = free_.lower_bound(start);
+        if (next != free_.end() && start + size == next->first) { size += next->second; next = free_.erase(next); }
+        if (next != free_.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == start) { start = prev->first; size += prev->second; free_.erase(prev); }
+        }
+        free_[start] = size;
+    }
+
+    uint64_t free_bytes() const {
+        uint64_t n = 0;
+        for (const auto& f : free_) n += f.second;
+        return n;
+    }
+    uint64_t largest_free() const {
+        uint64_t n = 0;
+        for (const auto& f : free_) n = std::max(n, f.second);
+        return n;
+    }
+    size_t live_allocations() const { return used_.size(); }
+
+private:
+    static bool is_pow2(uint64_t n) { return n && !(n & (n - 1)); }
+    uint64_t align_up(uint64_t v) const { return (v + cfg_.alignment - 1) & ~(cfg_.alignment - 1); }
+
+    BankConfig                   cfg_;
+    std::map<uint64_t, uint64_t> free_; // Address -> size, address-ordered
+    std::map<uint64_t, uint64_t> used_; // Address -> per-bank footprint
+};
+
+// Host staging memory configuration (see HostBufferPool::configure)
+struct HostPoolConfig {
+    int    numa_node = -1;               // Preferred NUMA node, e.g. the devices' PCIe root; -1 = any
+    bool   hugepages = true;             // Back blocks >= 2 MiB with hugepages when available
+    size_t max_cached_bytes = 1ULL << 30; // Released blocks kept for reuse, beyond this they are unmapped
+};
+
+// Process-wide pool of page-aligned host staging blocks. Blocks are mapped once,
+// pre-faulted, and recycled by size class on release, so repeated host_view() calls
+// reuse the same resident pages instead of allocating and faulting fresh ones.
+class HostBufferPool {
+public:
+    enum : size_t { kPage = 4096, kHugePage = 2u << 20 };
+
+    static HostBufferPool& instance() { static HostBufferPool p; return p; }
+    static void configure(const HostPoolConfig& cfg) {
+        HostBufferPool& p = instance();
+        std::lock_guard<std::mutex> lock(p.mu_);
+        p.cfg_ = cfg;
+    }
+
+    // Size class a request of `bytes` is served from
+    static size_t block_size(size_t bytes) {
+        size_t unit = bytes >= kHugePage ? kHugePage : kPage;
+        return ((bytes ? bytes : 1) + unit - 1) / unit * unit;
+    }
+
+    void* acquire(size_t bytes, size_t& block) {
+        block = block_size(bytes);
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            auto it = free_.find(block);
+            if (it != free_.end() && !it->second.empty()) {
+                void* p = it->second.back();
+                it->second.pop_back();
+                cached_ -= block;
+                ++reuses_;
+                return p;
+            }
+        }
+        return map_block(block);
+    }
+
+    void release(void* p, size_t block) {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (cached_ + block <= cfg_.max_cached_bytes) {
+                free_[block].push_back(p);
+                cached_ += block;
+                return;
+            }
+        }
+        unmap_block(p, block);
+    }
+
+    size_t cached_bytes() const { std::lock_guard<std::mutex> lock(mu_); return cached_; }
+    size_t reuses()       const { std::lock_guard<std::mutex> lock(mu_); return reuses_; }
+
+    ~HostBufferPool() {
+        for (auto& cls : free_) for (void* p : cls.second) unmap_block(p, cls.first);
+    }
+
+private:
+    HostBufferPool() {}
+
+    void* map_block(size_t block) {
+        HostPoolConfig cfg;
+        { std::lock_guard<std::mutex> lock(mu_); cfg = cfg_; }
+#if defined(__unix__) || defined(__APPLE__)
+        void* p = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+        if (cfg.hugepages && block % kHugePage == 0) {
+            p = mmap(nullptr, block, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+#endif
+        if (p == MAP_FAILED) {
+            p = mmap(nullptr, block, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) { std::cerr << "Error: host staging allocation of " << block << " bytes failed\n"; std::abort(); }
+#if defined(MADV_HUGEPAGE)
+            if (cfg.hugepages && block >= kHugePage) madvise(p, block, MADV_HUGEPAGE); // Transparent hugepages
+#endif
+        }
+        bind_to_node(p, block, cfg.numa_node);
+        // Pre-fault so the pages are resident on the chosen node before the first transfer.
+        // In a real implementation: also register (pin) the block with the device driver for DMA.
+        for (size_t off = 0; off < block; off += kPage) static_cast<volatile char*>(p)[off] = 0;
+        return p;
+#else
+        (void)cfg;
+        return ::operator new(block);
+#endif
+    }
+
+    static void unmap_block(void* p, size_t block) {
+#if defined(__unix__) || defined(__APPLE__)
+        munmap(p, block);
+#else
+        (void)block;
+        ::operator delete(p);
+#endif
+    }
+
+    static void bind_to_node(void* p, size_t block, int node) {
+#if defined(__linux__) && defined(SYS_mbind)
+        if (node < 0 || node >= 64) return;
+        const int kMpolPreferred = 1;        // MPOL_PREFERRED, without a libnuma dependency
+        unsigned long mask = 1UL << node;
+        syscall(SYS_mbind, p, block, kMpolPreferred, &mask, 64UL, 0U); // Best-effort
+#else
+        (void)p; (void)block; (void)node;
+#endif
+    }
+
+    mutable std::mutex mu_;
+    HostPoolConfig cfg_;
+    std::map<size_t, std::vector<void*> > free_; // Size class -> released blocks
+    size_t cached_ = 0;
+    size_t reuses_ = 0;
+};
+
+// Move-only handle to a pooled host staging block holding the rank-local region of a
+// MeshBuffer, row-major over region(). The block returns to the pool on destruction.
 class HostBuffer {
 public:
     void*  ptr()  { return data_; }
+    const void* ptr() const { return data_; }
     size_t size() const { return bytes_; }
 
-private:
-    friend class MeshBuffer;
-    explicit HostBuffer(size_t sz) : bytes_(sz) { data_ = std::malloc(sz); }
-    void*  data_;
-    size_t bytes_;
-};
+    const TensorRegion& region() const { return region_; } // Global tensor coords of ptr()[0..size())
+    DataType dtype()     const { return dtype_; }
+    size_t   row_pitch() const { return static_cast<size_t>(region_.width()) * element_size(dtype_); }
+    HostLayout layout()  const { return layout_; }
+    const TileShape& tile() const { return tile_; } // Meaningful for HostLayout::TILE
+
+    HostBuffer(HostBuffer&& o)
+        : data_(o.data_), bytes_(o.bytes_), block_(o.block_), region_(o.region_), dtype_(o.dtype_)
+        , layout_(o.layout_), tile_(o.tile_) { o.data_ = nullptr; }
+    HostBuffer& operator=(HostBuffer&& o) {
+        if (this != &o) {
+            reset();
+            data_ = o.data_; bytes_ = o.bytes_; block_ = o.block_; region_ = o.region_; dtype_ = o.dtype_;
+            layout_ = o.layout_; tile_ = o.tile_;
+            o.data_ = nullptr;
+        }
+        return *this;
+    }
+    HostBuffer(const HostBuffer&) = delete;
+    HostBuffer& operator=(const HostBuffer&) = delete;
+    ~HostBuffer() { reset(); }
+
+private:
+    friend class MeshBuffer;
+    friend class HostOps; // Sets the layout it produced
+    HostBuffer(const TensorRegion& region, DataType dtype)
+        : data_(nullptr), bytes_(region.elements() * element_size(dtype)), block_(0), region_(region), dtype_(dtype)
+        , layout_(HostLayout::ROW_MAJOR)
+    {
+        if (bytes_) data_ = HostBufferPool::instance().acquire(bytes_, block_);
+    }
+    void reset() {
+        if (data_) HostBufferPool::instance().release(data_, block_);
+        data_ = nullptr;
+    }
+    void*  data_;
+    size_t bytes_;
+    size_t block_; // Pool size class actually held
+    TensorRegion region_;
+    DataType     dtype_;
+    HostLayout   layout_;
+    TileShape    tile_;
+};
+
+class MeshBuffer {
+public:
+    // Whole tensor, all devices
+    size_t   bytes() const { return static_cast<size_t>(shape_.x) * shape_.y * element_size(spec_.dtype); }
+    // Host staging buffer for exactly this rank's region of the tensor (see host_region),
+    // in the buffer's layout (tiled when spec().layout is TILE)
+    HostBuffer host_view() const;
+
+    uint64_t   address() const { return base_; }      // Bank-local address, same in every bank
+    BufferType type()    const { return spec_.type; }
+    DataType   dtype()   const { return spec_.dtype; }
+    const BufferSpec& spec() const { return spec_; }
+    Shape      shape()   const { return shape_; }
+    bool       allocated() const { return allocated_; }
+
+    // Elements held by one device along each axis
+    Shape shard_shape() const {
+        return Shape(spec_.x == ShardMode::SHARDED ? ceil_div(shape_.x, owning_mesh_shape_.x) : shape_.x,
+                     spec_.y == ShardMode::SHARDED ? ceil_div(shape_.y, owning_mesh_shape_.y) : shape_.y);
+    }
+    size_t device_bytes() const {
+        Shape s = shard_shape();
+        return static_cast<size_t>(s.x) * s.y * element_size(spec_.dtype);
+    }
+    // Tensor region held by the devices in [devices) of the owning mesh
+    TensorRegion region_of(const DeviceRange& devices) const {
+        DeviceRange d = devices.intersect(DeviceRange::full(owning_mesh_shape_));
+        if (d.empty()) return TensorRegion();
+        Shape s = shard_shape();
+        return { axis_region(d.x_range, s.x, shape_.x, spec_.x), axis_region(d.y_range, s.y, shape_.y, spec_.y) };
+    }
+    // Union of the shards of this rank's local devices (replicated axes: full extent)
+    const TensorRegion& host_region() const { return host_region_; }
+
+private:
+    friend class MeshDevice;
+    MeshBuffer(uint64_t b, Shape shape, Shape owning_mesh_shape, const BufferSpec& spec, const DeviceRange& host_devices)
+        : base_(b), shape_(shape), owning_mesh_shape_(owning_mesh_shape), spec_(spec), allocated_(true)
+    {
+        host_region_ = region_of(host_devices);
+    }
+    static uint32_t ceil_div(uint32_t a, uint32_t b) { return b ? (a + b - 1) / b : a; }
+    static Range axis_region(Range devices, uint32_t shard, uint32_t extent, ShardMode mode) {
+        if (mode == ShardMode::REPLICATED) return Range(0, extent);
+        uint32_t start = std::min(devices.start * shard, extent);
+        return Range(start, std::min(devices.end * shard, extent));
+    }
+    uint64_t     base_;
+    Shape        shape_;
+    Shape        owning_mesh_shape_;
+    BufferSpec   spec_;
+    bool         allocated_;
+    TensorRegion host_region_;
+};
+
+class MeshWorkload {
+public:
+    // Contiguous run of words [offset, offset + count) that all target the same devices.
+    // multicast: the host writes the words to one head device per row of each host's part
+    // of the target (per column when that is fewer writes), and the fabric forwards them
+    // along it to the others, so host->device traffic does not grow with the target.
+    struct CmdRun {
+        size_t      offset;
+        size_t      count;
+        DeviceRange target;
+        bool        multicast;
+    };
+
+    // Every command targets every device of the target mesh
+    explicit MeshWorkload(std::vector<uint64_t>&& words, Shape target_mesh_shape)
+        : cmds_(std::make_shared<const std::vector<uint64_t> >(std::move(words)))
+        , target_mesh_shape_(target_mesh_shape) 
+    {
+        if (!cmds_->empty()) runs_.push_back({0, cmds_->size(), DeviceRange::full(target_mesh_shape_), false});
+        finalize(nullptr);
+    }
+
+    // Per-command targeting; runs must tile words in order (see Builder)
+    MeshWorkload(std::vector<uint64_t>&& words, std::vector<CmdRun>&& runs, Shape target_mesh_shape)
+        : cmds_(std::make_shared<const std::vector<uint64_t> >(std::move(words)))
+        , runs_(std::move(runs))
+        , target_mesh_shape_(target_mesh_shape) 
+    {
+        size_t next = 0;
+        for (const auto& r : runs_) {
+            assert(r.offset == next && "MeshWorkload runs must be contiguous and in order");
+            next = r.offset + r.count;
+        }
+        assert(next == cmds_->size() && "MeshWorkload runs must cover all words");
+        finalize(nullptr);
+    }
+
+    // Runtime argument: a word that may change between pushes of the same structure
+    // (buffer base, scalar). Its value is not part of structure().
+    struct ArgSlot {
+        size_t   offset; // Word index in words()
+        uint64_t value;
+    };
+
+    // Appends commands with a device target, coalescing neighbours that share one.
+    // Words are hashed as they are appended (runtime arguments as 0), so build() does
+    // not re-read the whole command stream.
+    class Builder {
+    public:
+        explicit Builder(Shape target_mesh_shape) : target_mesh_shape_(target_mesh_shape) {}
+
+        Builder& add(uint64_t word, const DeviceRange& target) { return add(&word, 1, target); }
+        Builder& add(const std::vector<uint64_t>& words, const DeviceRange& target) {
+            return add(words.data(), words.size(), target);
+        }
+        Builder& add(const uint64_t* words, size_t count, const DeviceRange& target) {
+            return append(words, count, target, false);
+        }
+        // Every device of the target mesh
+        Builder& add(uint64_t word) { return add(word, DeviceRange::full(target_mesh_shape_)); }
+
+        // The same commands for every device of `target`, lowered to a fabric multicast
+        // (see CmdRun::multicast)
+        Builder& multicast(uint64_t word, const DeviceRange& target) { return multicast(&word, 1, target); }
+        Builder& multicast(const std::vector<uint64_t>& words, const DeviceRange& target) {
+            return multicast(words.data(), words.size(), target);
+        }
+        Builder& multicast(const uint64_t* words, size_t count, const DeviceRange& target) {
+            return append(words, count, target, true);
+        }
+
+        // Runtime argument word; returns its index for MeshWorkload::set_arg
+        size_t add_arg(uint64_t value, const DeviceRange& target) {
+            uint64_t zero = 0;
+            add(&zero, 1, target); // Structure sees a placeholder
+            words_.back() = value;
+            args_.push_back({words_.size() - 1, value});
+            return args_.size() - 1;
+        }
+        size_t add_arg(uint64_t value) { return add_arg(value, DeviceRange::full(target_mesh_shape_)); }
+
+        MeshWorkload build() {
+            return MeshWorkload(std::move(words_), std::move(runs_), std::move(args_), target_mesh_shape_, &hash_);
+        }
+
+    private:
+        Builder& append(const uint64_t* words, size_t count, const DeviceRange& target, bool multicast) {
+            if (count == 0) return *this;
+            DeviceRange clipped = target.intersect(DeviceRange::full(target_mesh_shape_));
+            if (!runs_.empty() && runs_.back().target == clipped && runs_.back().multicast == multicast) {
+                runs_.back().count += count;
+            } else {
+                runs_.push_back({words_.size(), count, clipped, multicast});
+            }
+            words_.insert(words_.end(), words, words + count);
+            hash_.update(words, count);
+            return *this;
+        }
 
-class MeshBuffer {
-public:
-    size_t   bytes() const { return shape_.x * shape_.y; }
-    HostBuffer host_view() const;
+        Shape                 target_mesh_shape_;
+        std::vector<uint64_t> words_;
+        std::vector<CmdRun>   runs_;
+        std::vector<ArgSlot>  args_;
+        StreamHash64          hash_;  // Running hash of words_, arguments as 0
+    };
 
-private:
-    friend class MeshDevice;
-    MeshBuffer(uint64_t b, Shape shape, Shape owning_mesh_shape) : base_(b), shape_(shape), owning_mesh_shape_(owning_mesh_shape) {}
-    uint64_t  base_;
-    Shape     shape_;
-    Shape     owning_mesh_shape_;
-};
+    const std::vector<uint64_t>& words() const { return *cmds_; }
+    const std::vector<CmdRun>&   runs()  const { return runs_; }
+    // Shared handle over the whole command stream; copying it does not copy words
+    CmdSegment segment() const { return CmdSegment(cmds_); }
+    CmdSegment segment(const CmdRun& r) const { return CmdSegment(cmds_, r.offset, r.count); }
+    Shape target_mesh_shape() const { return target_mesh_shape_; }
+    // Bounding range of every run's target: the devices (and so hosts) this workload touches
+    const DeviceRange& footprint() const { return footprint_; }
+    // Hash of everything but runtime argument values: words, device targets, argument
+    // positions. Pushes of equal structure() reuse one encoding (see ProgramCache).
+    uint64_t structure() const { return structure_; }
+    // Current runtime arguments; words() keeps the values given at build time
+    const std::vector<ArgSlot>& args() const { return args_; }
+    // Update a runtime argument for the following pushes (lockstep: validated at push)
+    void set_arg(size_t i, uint64_t value) {
+        assert(i < args_.size() && "MeshWorkload argument index out of range");
+        args_[i].value = value;
+        args_dirty_ = true;
+    }
+    // Order-sensitive digest of words and device targets; 0 when validation was off
+    uint64_t digest() const { return digest_; }
+    // In-flight nonblocking validation (null unless Validation::Mode::NONBLOCKING)
+    const Validation::CheckHandle& pending_check() const { return check_; }
 
-class MeshWorkload {
-public:
-    explicit MeshWorkload(std::vector<uint64_t>&& words, Shape target_mesh_shape)
-        : cmds_(std::move(words)), target_mesh_shape_(target_mesh_shape) 
+private:
+    friend class MeshCQ;
+    // Builder path: words were already hashed while appending
+    MeshWorkload(std::vector<uint64_t>&& words, std::vector<CmdRun>&& runs, std::vector<ArgSlot>&& args,
+                 Shape target_mesh_shape, const StreamHash64* words_hash)
+        : cmds_(std::make_shared<const std::vector<uint64_t> >(std::move(words)))
+        , runs_(std::move(runs))
+        , args_(std::move(args))
+        , target_mesh_shape_(target_mesh_shape) 
     {
-        // Print informational message if debug enabled for this rank
-        int rank; MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-        if (Debug::should_print(rank)) {
+        finalize(words_hash);
+    }
+
+    uint64_t args_hash() const {
+        uint64_t h = structure_;
+        for (const auto& a : args_) h = mix64(h ^ a.value);
+        return h;
+    }
+
+    void finalize(const StreamHash64* words_hash) {
+        // Print informational message if debug enabled for this rank (rank only looked up then)
+        const int rank = Debug::enabled() ? HostCoordinator::get().rank() : -1;
+        if (Debug::enabled() && Debug::should_print(rank)) {
             std::cout << "[rank " << rank << "] Creating MeshWorkload for target mesh " 
-                      << to_string(target_mesh_shape_) << "...\n";
+                      << to_string(target_mesh_shape_) << " (" << runs_.size() << " targeted run(s))...\n";
+        }
+
+        /* order-sensitive hash (words, then their device targets, then argument slots) */
+        StreamHash64 hash;
+        if (words_hash) hash = *words_hash;
+        else            hash.update(cmds_->data(), cmds_->size());
+        for (const auto& r : runs_) {
+            footprint_ = footprint_.bounding(r.target);
+            uint64_t run[5] = { r.offset, r.count,
+                                (uint64_t(r.target.x_range.start) << 32) | r.target.x_range.end,
+                                (uint64_t(r.target.y_range.start) << 32) | r.target.y_range.end, r.multicast };
+            hash.update(run, 5);
         }
+        for (const auto& a : args_) hash.update(uint64_t(a.offset));
+        hash.update(uint64_t(target_mesh_shape_.x) << 32 | target_mesh_shape_.y);
+        structure_ = hash.digest();
 
         if (!Validation::on()) return;
-        /* hash for lock‑step test */
-        uint64_t h = 0;
-        for (auto w : cmds_) h ^= w * 0x9ddfea08eb382d69ULL;
-        uint64_t x;
-        MPI_Allreduce(&h, &x, 1, MPI_UINT64_T, MPI_BXOR, MPI_COMM_WORLD);
-        assert(x == 0 && "ranks diverged while building workload");
-        // Print success message if debug enabled for this rank
-        if (Debug::should_print(rank)) {
+        /* lock‑step test covers structure and argument values */
+        digest_ = args_.empty() ? structure_ : args_hash();
+        // Scoped validation: only the hosts the workload targets take part
+        const std::vector<int>* group = Validation::scoped() ? HostGrid::get().group_of(footprint_, target_mesh_shape_) : nullptr;
+        if (Validation::mode() == Validation::Mode::NONBLOCKING) {
+            check_ = Validation::post(digest_, "MeshWorkload", group); // Completed before dispatch
+            return;
+        }
+        Validation::check(digest_, "MeshWorkload", group);
+        // Print success message if debug enabled for this rank (deferred checks report at checkpoints)
+        if (Validation::blocking() && Debug::enabled() && Debug::should_print(rank)) {
             std::cout << "[rank " << rank << "] Validation: MeshWorkload constructor for target mesh " 
                       << to_string(target_mesh_shape_) << " OK\n"; 
         }
     }
-    const std::vector<uint64_t>& words() const { return cmds_; }
 
-private:
-    std::vector<uint64_t> cmds_;
+    CmdSegment::Storage cmds_; // Immutable once constructed, shared with DeviceCQs
+    std::vector<CmdRun> runs_; // Device targeting, tiles cmds_ in order
+    std::vector<ArgSlot> args_; // Runtime arguments, by increasing offset
     Shape target_mesh_shape_;
+    DeviceRange footprint_;
+    uint64_t structure_ = 0;
+    uint64_t digest_ = 0;
+    mutable bool args_dirty_ = false; // set_arg since the last validated push
+    Validation::CheckHandle check_; // Nonblocking validation of this workload, if posted
 };
 
 class MeshDevice; // Forward declaration
 
+// Completion handle for one MeshCQ::push. Copies share state; a default-constructed
+// event is already complete. Completion means the push reached the local DeviceCQs
+// and was dispatched for every local device it targets.
+class MeshEvent {
+public:
+    MeshEvent() {}
+
+    uint64_t id() const { return state_ ? state_->id : 0; }
+    bool ready() const {
+        if (!state_) return true;
+        std::lock_guard<std::mutex> lock(state_->mu);
+        return state_->done;
+    }
+    // Sync MeshCQ: only returns once dispatch_pending ran (see MeshDevice::wait(event))
+    void wait() const {
+        if (!state_) return;
+        std::unique_lock<std::mutex> lock(state_->mu);
+        state_->cv.wait(lock, [this] { return state_->done; });
+    }
+    // Devices the op may touch, identical on every rank; empty for a default event
+    DeviceRange scope() const { return state_ ? state_->scope : DeviceRange(); }
+
+private:
+    friend class MeshCQ;
+    struct State {
+        explicit State(uint64_t i) : id(i) {}
+        std::mutex              mu;
+        std::condition_variable cv;
+        bool                    done = false;
+        uint64_t                id;
+        DeviceRange             scope; // Set before the event is returned, then read-only
+    };
+    explicit MeshEvent(uint64_t id) : state_(std::make_shared<State>(id)) {}
+    void complete() const {
+        {
+            std::lock_guard<std::mutex> lock(state_->mu);
+            state_->done = true;
+        }
+        state_->cv.notify_all();
+    }
+    std::shared_ptr<State> state_;
+};
+
+// Device-ready encoding of one workload structure for this host: one binary per distinct
+// list of runs that local devices receive (the words of those runs concatenated), shared
+// by every device with that list, plus where each runtime argument lands in it. Costs
+// words per distinct list plus an index per device, not a copy of the words per device.
+struct Program {
+    struct Binary {
+        std::vector<size_t> devices;                   // Local devices running it, ascending
+        std::vector<size_t> fabric_words;              // Per device: words delivered by a multicast head
+        CmdSegment view;                               // One argument-free run: the workload's own words
+        std::shared_ptr<std::vector<uint64_t> > words; // Otherwise: the runs, joined and patched
+        std::vector<std::pair<size_t, size_t> > args;  // (argument index, position in words)
+        // What each of its devices enqueues; shared with the DeviceCQs
+        CmdSegment segment() const { return words ? CmdSegment(words) : view; }
+    };
+    std::vector<Binary> binaries; // Local devices with work only
+    size_t   skipped_runs = 0;    // Runs not targeting this host
+    uint64_t last_use = 0;
+};
+
+// Encoded Programs keyed by MeshWorkload::structure(), least recently used evicted first.
+// Only touched from the thread that enqueues into the DeviceCQs.
+class ProgramCache {
+public:
+    explicit ProgramCache(size_t capacity = 64) : capacity_(capacity) {}
+
+    void   set_capacity(size_t c) { capacity_ = c; programs_.clear(); }
+    size_t capacity() const { return capacity_; }
+    size_t size()     const { return programs_.size(); }
+    size_t hits()     const { return hits_; }
+    size_t misses()   const { return misses_; }
+
+    Program* find(uint64_t key) {
+        auto it = programs_.find(key);
+        if (it == programs_.end()) { ++misses_; return nullptr; }
+        ++hits_;
+        it->second.last_use = ++clock_;
+        return &it->second;
+    }
+    // capacity 0: the returned Program is valid until the next insert
+    Program& insert(uint64_t key, Program&& p) {
+        if (capacity_ == 0) { scratch_ = std::move(p); return scratch_; }
+        if (programs_.size() >= capacity_) {
+            auto lru = programs_.begin();
+            for (auto it = programs_.begin(); it != programs_.end(); ++it) {
+                if (it->second.last_use < lru->second.last_use) lru = it;
+            }
+            programs_.erase(lru);
+        }
+        p.last_use = ++clock_;
+        return programs_[key] = std::move(p);
+    }
+
+private:
+    size_t   capacity_;
+    size_t   hits_ = 0, misses_ = 0;
+    uint64_t clock_ = 0;
+    std::map<uint64_t, Program> programs_;
+    Program  scratch_;
+};
+
 class MeshCQ {
 public:
     // Constructor takes owning device
     explicit MeshCQ(MeshDevice& dev) : dev_(dev) {}
-
-    // Push dispatches workload to local device CQs
-    void push(const MeshWorkload& wl);
+    ~MeshCQ() { stop_async(); }
+
+    // Push dispatches workload to local device CQs.
+    // Synchronous mode: commands are enqueued now and the event completes at the next
+    // MeshDevice::dispatch_pending. Async mode: the workload is handed to the dispatch
+    // thread and push only blocks while async_depth pushes are already in flight.
+    MeshEvent push(const MeshWorkload& wl);
+    // Push `count` workloads as one op: each local device receives the commands of all of
+    // them, in order, as a single contiguous segment (one DeviceCQ entry and one drain per
+    // device), behind one event. Per-workload validation is unchanged; the encode, ring
+    // and completion work is paid once per batch. Ordered with other pushes like a push.
+    MeshEvent push(const MeshWorkload* wls, size_t count);
+    MeshEvent push(const std::vector<MeshWorkload>& wls) { return push(wls.data(), wls.size()); }
+
+    // Copy this rank's region of `buf` between `host` and each local device's shard,
+    // straight from/to the HostBuffer's memory. Issued per device through the DeviceCQs
+    // (ordered with pushed workloads, drained in parallel by the dispatch pool) and
+    // completed like a push; `host` must stay alive until the event completes.
+    // Replicated axes: writes go to every local replica, reads come from one of them.
+    MeshEvent enqueue_write(const MeshBuffer& buf, const HostBuffer& host, bool blocking = false);
+    MeshEvent enqueue_read(const MeshBuffer& buf, HostBuffer& host, bool blocking = false);
+    // Write from caller memory (e.g. a mapped file): `src` holds `region` of the tensor
+    // row-major, rows `row_pitch` bytes apart. Same ordering and lifetime rules as above.
+    MeshEvent enqueue_write(const MeshBuffer& buf, const void* src, const TensorRegion& region,
+                            size_t row_pitch, bool blocking = false);
+
+    // Block until every push so far has completed locally (no cross-host sync)
+    void finish();
+
+    // Trace capture: between begin_trace and end_trace every push is recorded as this
+    // host's already filtered, per-DeviceCQ command streams (commands still run as usual;
+    // transfers are not allowed). replay_trace re-issues the whole capture with one call:
+    // no encoding, filtering or validation work per push, and no MPI unless validation is
+    // on. Lockstep: all ranks capture, replay and release the same traces in order.
+    void      begin_trace();
+    uint32_t  end_trace();                                  // Id of the captured trace
+    MeshEvent replay_trace(uint32_t id, bool blocking = false);
+    void      release_trace(uint32_t id);
+
+    bool   async() const { return worker_.joinable(); }
+    size_t in_flight() const { std::lock_guard<std::mutex> lock(mu_); return in_flight_; }
+    // Pre-encoded workloads; read its counters only while the queue is idle
+    const ProgramCache& programs() const { return programs_; }
+    // Command words enqueued so far for this host's devices: written by the host, and
+    // forwarded by multicast heads over the fabric. Same rule as programs().
+    uint64_t host_words()   const { return host_words_; }
+    uint64_t fabric_words() const { return fabric_words_; }
     
-    // const std::vector<uint64_t>& cmds() const { return cmds_; } // REMOVE - No longer stores commands
 private:
-    // friend class MeshDevice; // Keep friendship if needed for cq_ init
-    // std::vector<uint64_t> cmds_; // REMOVE
+    friend class MeshDevice;
+    // Encode (or reuse), patch and enqueue into the local DeviceCQs, one segment per device
+    void enqueue_local(const MeshWorkload* wls, size_t count);
+    Program encode(const MeshWorkload& wl) const;
+    // Validate one MeshCQ op in the current mode, among `group` when scoped (null = all ranks)
+    void lockstep(uint64_t op_hash, const char* what, const std::vector<int>* group = nullptr);
+    void track_check(const Validation::CheckHandle& c);   // Settle a posted check before its op dispatches
+    // Host memory is in the buffer's layout (tilized: rows are rows of tiles).
+    // host_pitch: bytes between host rows, 0 = densely packed host_region.
+    void enqueue_transfer(Transfer::Dir dir, const MeshBuffer& buf, uint8_t* host,
+                          const TensorRegion& host_region, size_t element_bytes, size_t host_pitch = 0);
+    static bool same_layout(const MeshBuffer& buf, const HostBuffer& host) {
+        const TileShape& a = buf.spec().tile;
+        const TileShape& b = host.tile();
+        return buf.spec().layout == host.layout() &&
+               (host.layout() != HostLayout::TILE || (a.h == b.h && a.w == b.w && a.face_h == b.face_h && a.face_w == b.face_w));
+    }
+    // Sync enqueue or hand to the dispatch thread; scope becomes MeshEvent::scope()
+    MeshEvent submit(const std::function<void()>& enqueue, bool blocking, const DeviceRange& scope = DeviceRange());
+    void complete_checks();                     // Sync mode: settle validation before dispatch
+    void complete_pending();                    // Sync mode: complete events after dispatch
+    void start_async(size_t depth);
+    void stop_async();
+    void async_loop();
+    // Enqueue into one local DeviceCQ, waiting for room while its ring is full
+    template <typename... T> void put(size_t device, const T&... item);
+    void make_room(size_t device);
+
     MeshDevice& dev_; // Reference to owning device
+    uint64_t    next_event_id_ = 0;
+    std::vector<MeshEvent> pending_events_; // Sync mode: pushed, not yet dispatched
+    std::vector<Validation::CheckHandle> pending_checks_; // Sync mode: completed before dispatch
+    ProgramCache programs_;
+    std::vector<std::vector<CmdSegment> > parts_; // enqueue_local scratch: per local device
+    std::vector<size_t> parts_fabric_;            // Fabric-delivered words of parts_
+    uint64_t    host_words_ = 0, fabric_words_ = 0;
+
+    // Traces: host-thread state (enqueue lambdas run on the pushing thread in both modes)
+    typedef std::vector<std::pair<size_t, CmdSegment> > Trace; // (local device, stream)
+    bool        tracing_ = false;
+    uint32_t    next_trace_id_ = 0;
+    DeviceRange trace_scope_;                                  // Footprint of the pushes being captured
+    std::map<uint32_t, DeviceRange> trace_scopes_;
+    bool        capturing_ = false;
+    std::vector<std::vector<CmdSegment> > capture_;            // Per local device
+    std::map<uint32_t, Trace> traces_;
+
+    // Async mode state, guarded by mu_. The DeviceCQ rings themselves are lock-free.
+    std::thread             worker_;
+    mutable std::mutex      mu_;
+    std::condition_variable work_cv_, space_cv_, idle_cv_;
+    std::deque<MeshEvent>   queue_;         // Enqueued, completed once the rings are drained past them
+    size_t                  depth_ = 0;
+    size_t                  in_flight_ = 0; // Queued or being dispatched
+    bool                    drain_ = false; // A ring is full: drain even without a new event
+    bool                    stop_ = false;
 };
 
 struct HostSubmesh {
@@ -205,47 +2244,129 @@ public:
 
     // Update signature to include config args
     static MeshDevice& open(Shape mesh_shape, Shape host_submesh_shape, 
-                           bool enable_validation, Debug::Mode debug_mode, int debug_rank) 
+                           bool enable_validation, Debug::Mode debug_mode, int debug_rank,
+                           const DispatchConfig& dispatch = DispatchConfig(),
+                           const AllocatorConfig& memory = AllocatorConfig(),
+                           const PlacementConfig& placement = PlacementConfig(),
+                           const StartupConfig& startup = StartupConfig(),
+                           const Topology& topology = Topology()) 
     {
+        // One physical mesh per process: reopening returns it, a different shape is an error
+        std::unique_ptr<MeshDevice>& dev = opened();
+        if (dev) {
+            if (dev->closed_ || dev->mesh_shape_.x != mesh_shape.x || dev->mesh_shape_.y != mesh_shape.y ||
+                dev->host_submesh_shape_.x != host_submesh_shape.x || dev->host_submesh_shape_.y != host_submesh_shape.y ||
+                dev->topology_.wrap_x != topology.wrap_x || dev->topology_.wrap_y != topology.wrap_y) {
+                if (dev->rank_ == 0) {
+                    std::cerr << "Error: MeshDevice::open(" << to_string(mesh_shape) << ", " << to_string(host_submesh_shape)
+                              << "): mesh " << to_string(dev->mesh_shape_) << (dev->closed_ ? " was closed" : " is already open")
+                              << "; use create_submesh for a part of it\n";
+                }
+                if (dev->closed_) std::exit(1); // Transport already finalized
+                HostCoordinator::get().abort(1);
+            }
+            return *dev;
+        }
         // Configure validation and debugging *early* so constructor messages are gated
         // Note: MPI is guaranteed to be initialized within the constructor called below
         Validation::enabled(enable_validation);
         Debug::configure(debug_mode, debug_rank);
-        
-        // Static local guarantees construction only happens once
-        static MeshDevice dev(mesh_shape, host_submesh_shape); 
-        return dev;
+        dev.reset(new MeshDevice(mesh_shape, host_submesh_shape, dispatch, memory, placement, startup, topology));
+        return *dev;
     }
-    static void close() { get().teardown(); }
+    static void close() { if (opened()) opened()->teardown(); }
+
+    // Lockstep: an independent MeshDevice over `region` of this one (e.g. one data-parallel
+    // replica): its own shape and coordinates for workloads and buffers, its own MeshCQ,
+    // DeviceCQs and dispatch settings, so it is queued and dispatched without serializing
+    // behind other submeshes (with async_depth, concurrently on its own thread). It shares
+    // the physical devices and their allocators with this mesh; streams dispatched
+    // concurrently should use disjoint regions. Release before close().
+    std::shared_ptr<MeshDevice> create_submesh(const DeviceRange& region,
+                                               const DispatchConfig& dispatch = DispatchConfig());
 
     MeshBuffer allocate(Shape shape);
     // Add overload for overriding owning mesh shape
     MeshBuffer allocate(Shape shape, Shape owning_mesh_shape_override);
+    MeshBuffer allocate(Shape shape, BufferType type);
+    MeshBuffer allocate(Shape shape, const BufferSpec& spec);
+    // Lockstep: must be called at the same logical point on every rank
+    void       deallocate(MeshBuffer& buf);
+    const BankAllocator& allocator(BufferType type) const { return type == BufferType::DRAM ? root_->dram_ : root_->l1_; }
     MeshCQ&    cq() { return cq_; }
 
-    void dispatch_pending();   /* encode only rank‑local cmds (stub) */
+    void dispatch_pending();   /* encode only rank‑local cmds (stub); no-op for an async MeshCQ */
     void wait();               /* poll + final barrier          (stub) */
+    // Local completion of one push (dispatching it first on a sync MeshCQ). No MPI unless
+    // sync_hosts: then also sync(ev.scope()), with only the hosts that op touched.
+    void wait(const MeshEvent& ev, bool sync_hosts = false);
+    // Barrier among just the ranks whose host submesh intersects `devices`; other ranks
+    // return at once. Every rank must pass the same range (lockstep).
+    void sync(const DeviceRange& devices);
+    // Barrier among the ranks of this host's row / column of the host grid (see HostGrid)
+    void sync_row();
+    void sync_column();
+    HostGrid& host_grid() { return HostGrid::get(); }
+
+    ~MeshDevice() { cq_.stop_async(); } // Dispatch thread uses local_
 
     int rank()  const { return rank_;  }
     int world() const { return world_; }
     Shape host_submesh_shape() const { return host_submesh_shape_; }
     Shape mesh_shape() const { return mesh_shape_; }
-    const HostSubmesh& host_submesh() const { return host_submesh_; }
+    const HostSubmesh& host_submesh() const { return host_submesh_; } // This host's part, in this mesh's coordinates
+    // Where this mesh sits in the opened one (the full mesh unless a submesh)
+    const DeviceRange& region() const { return region_; }
+    bool is_submesh() const { return root_ != this; }
+    // Wraparound of this mesh: a submesh wraps only along axes it spans completely
+    const Topology& topology() const { return topology_; }
+    // Device `step` hops from `coord` along `axis`, in this mesh's coordinates; false past
+    // an edge that does not wrap. Constant-time; pair with locate() for the owning rank.
+    bool neighbor(Shape coord, Axis axis, int32_t step, Shape& out) const {
+        return topology_.neighbor(mesh_shape_, coord, axis, step, out);
+    }
+
+    // Constant-time device lookup, in this mesh's coordinates. Local index: position in
+    // this host's part of the mesh, row-major (what DeviceCQ, Program and trace use).
+    struct DeviceLocation { int rank; size_t local_index; };
+    DeviceLocation locate(Shape coord) const;      // Owning rank, and the index on that rank
+    size_t local_device_count() const { return local_.size(); }
+    bool   is_local(Shape coord) const { return DeviceRange(host_submesh_.x_range, host_submesh_.y_range).contains(coord); }
+    size_t local_index(Shape coord) const {        // Requires is_local(coord)
+        return size_t(coord.y - host_submesh_.y_range.start) * host_submesh_.shape.x + (coord.x - host_submesh_.x_range.start);
+    }
+    Shape  global_coords(size_t local_index) const {
+        return Shape(host_submesh_.x_range.start + uint32_t(local_index % host_submesh_.shape.x),
+                     host_submesh_.y_range.start + uint32_t(local_index / host_submesh_.shape.x));
+    }
 
 private:
     // Private helper for allocation logic
-    MeshBuffer allocate_impl(Shape buffer_shape, Shape owning_mesh_shape);
-
-    explicit MeshDevice(Shape mesh_shape, Shape host_submesh_shape);
+    MeshBuffer allocate_impl(Shape buffer_shape, Shape owning_mesh_shape, const BufferSpec& spec);
+    BankAllocator& mutable_allocator(BufferType type) { return type == BufferType::DRAM ? root_->dram_ : root_->l1_; }
+
+    explicit MeshDevice(Shape mesh_shape, Shape host_submesh_shape, const DispatchConfig& dispatch,
+                        const AllocatorConfig& memory, const PlacementConfig& placement,
+                        const StartupConfig& startup, const Topology& topology);
+    MeshDevice(MeshDevice& parent, const DeviceRange& region, const DispatchConfig& dispatch); // Submesh
+    void configure_dispatch(const DispatchConfig& dispatch); // Worker pool, program cache, async MeshCQ
+    void create_devices(Shape host, size_t cq_entries);      // This host's Devices and local_ table
+    void bring_up_devices(const StartupConfig& startup, bool background = false); // Device::bring_up on the startup threads
     void teardown();
-    static MeshDevice& get() {
-        // If get() is called, constructor must have run, so first_call_done is true.
-        assert(first_call_done && "MeshDevice not initialized. Call open() first.");
-        // Update call to open with default config values
-        static MeshDevice& instance_ref = open({1,1}, {1,1}, 
-                                                true, Debug::Mode::NONE, -1); // Validation ON, Debug NONE by default for internal get()
-        return instance_ref;
+    void dispatch_device(size_t device);       // Drain one local DeviceCQ; safe to call concurrently for distinct devices
+    void dispatch_local();                     // Drain all local DeviceCQs (serial or on dispatch_pool_)
+    // This mesh's coordinates -> the opened mesh's (clipped to this mesh)
+    DeviceRange to_root(const DeviceRange& devices) const {
+        DeviceRange d = devices.intersect(DeviceRange::full(mesh_shape_));
+        if (d.empty()) return DeviceRange();
+        return DeviceRange(Range(d.x_range.start + region_.x_range.start, d.x_range.end + region_.x_range.start),
+                           Range(d.y_range.start + region_.y_range.start, d.y_range.end + region_.y_range.start));
+    }
+    // Validation group of an op on `devices` of this mesh (scoped validation)
+    const std::vector<int>* group_of(const DeviceRange& devices) const {
+        return Validation::scoped() ? HostGrid::get().group_of(to_root(devices), root_->mesh_shape_) : nullptr;
     }
+    static std::unique_ptr<MeshDevice>& opened() { static std::unique_ptr<MeshDevice> d; return d; }
     void print_host_submesh_layout();
 
     void print_system_config() const {
@@ -255,41 +2376,44 @@ private:
                       << "  World Size: " << world_ << " ranks\n"
                       << "  Host SubMesh: " << host_submesh_shape_.x << "x" << host_submesh_shape_.y << "\n"
                       << "  Host Mesh: " << (mesh_shape_.x / host_submesh_shape_.x) << "x" 
-                                       << (mesh_shape_.y / host_submesh_shape_.y) << "\n\n";
+                                       << (mesh_shape_.y / host_submesh_shape_.y) << "\n"
+                      << "  Topology: " << to_string(topology_) << "\n\n";
         }
     }
 
     int     rank_, world_;
     Shape   mesh_shape_;
     Shape   host_submesh_shape_;
+    Topology topology_; // Wraparound axes, see topology()
     HostSubmesh host_submesh_;
+    MeshDevice* root_;   // The opened mesh; this, unless a submesh
+    DeviceRange region_; // In root_'s coordinates
+    bool    closed_ = false;
     MeshCQ  cq_;
-    static bool first_call_done;
-    // Store local devices, not just their CQs
-    std::vector<Device> local_devices_; // Devices locally owned by this host
+    BankAllocator dram_; // Device address space, identical on every rank (used via root_)
+    BankAllocator l1_;
+    std::vector<Device> devices_;            // Physical devices of this host (opened mesh only)
+    LocalDeviceTable local_;                 // This mesh's view of them, by local index
+    std::unique_ptr<WorkerPool> dispatch_pool_; // Null when dispatch is serial
+    std::mutex print_mu_;                       // Serializes debug output from dispatch workers
 };
 
-inline MeshDevice::MeshDevice(Shape mesh_shape, Shape host_submesh_shape)
+inline MeshDevice::MeshDevice(Shape mesh_shape, Shape host_submesh_shape, const DispatchConfig& dispatch,
+                              const AllocatorConfig& memory, const PlacementConfig& placement,
+                              const StartupConfig& startup, const Topology& topology)
     : mesh_shape_(validate_mesh_shape(mesh_shape))
     , host_submesh_shape_(validate_host_submesh_shape(mesh_shape, host_submesh_shape))
+    , topology_(topology)
+    , root_(this)
+    , region_(DeviceRange::full(mesh_shape))
     , cq_(*this)
+    , dram_(memory.dram)
+    , l1_(memory.l1)
 {
-    // Check if constructor is being entered a second time (problematic with static local in open)
-    // This check needs to be robust across MPI processes.
-    // We use a simple flag, assuming MPI processes execute this constructor roughly simultaneously
-    // after the static variable initialization barrier.
-    if (first_call_done) {
-        // This scenario shouldn't happen with the static local in open(),
-        // but we keep the check as a safeguard.
-        std::cerr << "Error: MeshDevice constructor called more than once.\n";
-        std::exit(1); // Or MPI_Abort
-    }
-
-    int init = 0;
-    MPI_Initialized(&init);
-    if (!init) MPI_Init(nullptr, nullptr);
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank_);
-    MPI_Comm_size(MPI_COMM_WORLD, &world_);
+    HostCoordinator& coord = HostCoordinator::get(); // Initializes the transport (e.g. MPI_Init)
+    rank_  = coord.rank();
+    world_ = coord.size();
+    if (Tracer::on()) Tracer::align(); // Before anything is recorded
 
     // Configuration calls moved to open(), called before this constructor runs
 
@@ -301,8 +2425,7 @@ inline MeshDevice::MeshDevice(Shape mesh_shape, Shape host_submesh_shape)
             std::cerr << "Error: MPI world size " << world_ 
                       << " does not match expected host count " << expected_hosts << "\n";
         }
-        MPI_Abort(MPI_COMM_WORLD, 1); // Use MPI_Abort for cleaner exit across ranks
-        // std::exit(1); // Replaced with MPI_Abort
+        HostCoordinator::get().abort(1); // Cleaner exit across ranks than std::exit
     } else {
         // Print success message if debug enabled for this rank
         if (Debug::should_print(rank_)) {
@@ -310,43 +2433,37 @@ inline MeshDevice::MeshDevice(Shape mesh_shape, Shape host_submesh_shape)
         }
     }
 
-    // Calculate this host's submesh range
-    uint32_t hosts_x = mesh_shape_.x / host_submesh_shape_.x;
-    uint32_t hosts_y = mesh_shape_.y / host_submesh_shape_.y;
-    
-    uint32_t host_x = rank_ % hosts_x;
-    uint32_t host_y = rank_ / hosts_x;
-
-    host_submesh_.x_range = {
-        host_x * host_submesh_shape_.x,
-        (host_x + 1) * host_submesh_shape_.x
-    };
-    host_submesh_.y_range = {
-        host_y * host_submesh_shape_.y,
-        (host_y + 1) * host_submesh_shape_.y
-    };
-    host_submesh_.shape = host_submesh_shape_;
-
-    // Initialize the local devices vector
-    uint32_t submesh_width = host_submesh_shape_.x;
-    uint32_t submesh_height = host_submesh_shape_.y;
-    size_t local_device_count = static_cast<size_t>(submesh_width) * submesh_height;
-    local_devices_.reserve(local_device_count); // Reserve space
-
-    uint32_t global_start_x = host_submesh_.x_range.start;
-    uint32_t global_start_y = host_submesh_.y_range.start;
+    // Bring-up of the local devices overlaps the rest of the wire-up. With row-major
+    // placement the host submesh follows from the rank alone, so it starts right away;
+    // other policies have to place the ranks (collectively) first.
+    const uint32_t hosts_x = mesh_shape_.x / host_submesh_shape_.x;
+    const bool early = startup.overlap && placement.policy == PlacementConfig::Policy::ROW_MAJOR;
+    std::thread bring_up;
+    if (early) {
+        create_devices(Shape(uint32_t(rank_) % hosts_x, uint32_t(rank_) / hosts_x), dispatch.device_cq_entries);
+        bring_up = std::thread(&MeshDevice::bring_up_devices, this, std::cref(startup), true);
+    }
 
-    if (Debug::should_print(rank_)) {
-         std::cout << "[rank " << rank_ << "] Initializing " << local_device_count << " local devices...\n";
+    // Place the ranks on the host grid (row-major unless configured). Also derives the
+    // row/column/node rank groups.
+    HostGrid::get().configure(mesh_shape_, host_submesh_shape_, rank_, placement, topology_);
+    if (!early) {
+        create_devices(HostGrid::get().host(), dispatch.device_cq_entries);
+        if (startup.overlap) bring_up = std::thread(&MeshDevice::bring_up_devices, this, std::cref(startup), true);
+        else                 bring_up_devices(startup);
     }
-    for (uint32_t ly = 0; ly < submesh_height; ++ly) {
-        for (uint32_t lx = 0; lx < submesh_width; ++lx) {
-            uint32_t gx = global_start_x + lx;
-            uint32_t gy = global_start_y + ly;
-            // Pass both global and local coordinates to Device constructor
-            local_devices_.emplace_back(Shape(gx, gy), Shape(lx, ly)); 
-            local_devices_.back().print_creation_info(rank_); 
-        }
+    const Shape host = HostGrid::get().host();
+    assert(host.x * host_submesh_shape_.x == host_submesh_.x_range.start &&
+           host.y * host_submesh_shape_.y == host_submesh_.y_range.start && "early bring-up on the wrong host");
+    if (Tracer::on()) {
+        Tracer::name_process("rank " + std::to_string(rank_) + " host (" + std::to_string(host.x) + "," +
+                             std::to_string(host.y) + ")");
+    }
+    if (startup.overlap) {
+        // Set up the row and column communicators now rather than at first use, while
+        // devices are still coming up (every rank joins its row's, then its column's)
+        coord.barrier(HostGrid::get().row());
+        coord.barrier(HostGrid::get().column());
     }
 
     // Determine if this rank should print the global config/layout
@@ -361,19 +2478,158 @@ inline MeshDevice::MeshDevice(Shape mesh_shape, Shape host_submesh_shape)
     // Mode 'none': should_print_global remains false
 
     // Print global info if this rank is designated
-    if (should_print_global) {
+    if (BuildConfig::debug && should_print_global) {
         print_system_config(); 
         print_host_submesh_layout();
     }
-    
-    MPI_Barrier(MPI_COMM_WORLD);
+
+    configure_dispatch(dispatch);
+
+    if (bring_up.joinable()) bring_up.join(); // Bounded by the slowest local device
+    if (Debug::should_print(rank_)) {
+        for (const auto& d : devices_) d.print_creation_info(rank_);
+    }
+    HostCoordinator::get().barrier();
+    Stragglers::depart(); // The first step starts once every rank has opened
     // Gate the rank-specific ownership message with general debug settings
     if (Debug::should_print(rank_)) {
-        std::cout << "[rank " << rank_ << "] owns " << host_submesh_.to_string() << " region.\n";
+        const HostGrid& g = HostGrid::get();
+        std::cout << "[rank " << rank_ << "] owns " << host_submesh_.to_string() << " region. Neighbour ranks x-/x+/y-/y+: "
+                  << g.neighbor_rank(Axis::X, -1) << "/" << g.neighbor_rank(Axis::X, 1) << "/"
+                  << g.neighbor_rank(Axis::Y, -1) << "/" << g.neighbor_rank(Axis::Y, 1) << "\n";
+    }
+}
+
+inline MeshDevice::MeshDevice(MeshDevice& parent, const DeviceRange& region, const DispatchConfig& dispatch)
+    : rank_(parent.rank_)
+    , world_(parent.world_)
+    , mesh_shape_(region.shape())
+    , host_submesh_shape_(parent.host_submesh_shape_)
+    , root_(parent.root_)
+    , region_(parent.to_root(region))
+    , cq_(*this)
+    , dram_(root_->dram_.config()) // Unused: allocations go to root_'s
+    , l1_(root_->l1_.config())
+{
+    topology_.wrap_x = root_->topology_.wrap_x && region_.x_range.size() == root_->mesh_shape_.x;
+    topology_.wrap_y = root_->topology_.wrap_y && region_.y_range.size() == root_->mesh_shape_.y;
+    // This host's devices inside the region, in the root's row-major order
+    const HostSubmesh& host = root_->host_submesh_;
+    DeviceRange mine = region_.intersect(DeviceRange(host.x_range, host.y_range));
+    if (!mine.empty()) {
+        host_submesh_.x_range = Range(mine.x_range.start - region_.x_range.start, mine.x_range.end - region_.x_range.start);
+        host_submesh_.y_range = Range(mine.y_range.start - region_.y_range.start, mine.y_range.end - region_.y_range.start);
+        host_submesh_.shape = Shape(mine.x_range.size(), mine.y_range.size());
+    }
+    for (size_t i = 0; i < root_->local_.size(); ++i) {
+        const Shape c = root_->local_.coords[i];
+        if (!mine.contains(c)) continue;
+        local_.add(root_->local_.devices[i], Shape(c.x - region_.x_range.start, c.y - region_.y_range.start),
+                   dispatch.device_cq_entries);
+    }
+    configure_dispatch(dispatch);
+    if (Debug::should_print(rank_)) {
+        std::cout << "[rank " << rank_ << "] submesh " << to_string(region_) << " (" << to_string(mesh_shape_)
+                  << "): owns " << (mine.empty() ? std::string("no devices") : host_submesh_.to_string()) << "\n";
+    }
+}
+
+inline std::shared_ptr<MeshDevice> MeshDevice::create_submesh(const DeviceRange& region, const DispatchConfig& dispatch) {
+    DeviceRange r = region.intersect(DeviceRange::full(mesh_shape_));
+    if (r.empty() || r.x_range.size() != region.x_range.size() || r.y_range.size() != region.y_range.size()) {
+        if (rank_ == 0) {
+            std::cerr << "Error: create_submesh " << to_string(region) << " is not a non-empty part of the "
+                      << to_string(mesh_shape_) << " mesh\n";
+        }
+        HostCoordinator::get().abort(1);
+    }
+    if (Validation::on()) {
+        uint64_t crc = mix64(0x7375626d657368ULL ^ (uint64_t(r.x_range.start) << 48 | uint64_t(r.x_range.end) << 32 |
+                                                    uint64_t(r.y_range.start) << 16 | r.y_range.end));
+        Validation::check(crc, "MeshDevice::create_submesh");
+    }
+    return std::shared_ptr<MeshDevice>(new MeshDevice(*this, r, dispatch));
+}
+
+inline MeshDevice::DeviceLocation MeshDevice::locate(Shape coord) const {
+    assert(DeviceRange::full(mesh_shape_).contains(coord) && "MeshDevice::locate outside the mesh");
+    // Opened mesh coordinates -> host slot -> that host's part of this mesh
+    const Shape g(coord.x + region_.x_range.start, coord.y + region_.y_range.start);
+    const Shape sub = host_submesh_shape_;
+    const Shape host(g.x / sub.x, g.y / sub.y);
+    const DeviceRange part = region_.intersect(DeviceRange(Range(host.x * sub.x, (host.x + 1) * sub.x),
+                                                           Range(host.y * sub.y, (host.y + 1) * sub.y)));
+    DeviceLocation loc;
+    loc.rank = HostGrid::get().rank_at(host);
+    loc.local_index = size_t(g.y - part.y_range.start) * part.x_range.size() + (g.x - part.x_range.start);
+    return loc;
+}
+
+inline void MeshDevice::create_devices(Shape host, size_t cq_entries) {
+    host_submesh_.x_range = { host.x * host_submesh_shape_.x, (host.x + 1) * host_submesh_shape_.x };
+    host_submesh_.y_range = { host.y * host_submesh_shape_.y, (host.y + 1) * host_submesh_shape_.y };
+    host_submesh_.shape = host_submesh_shape_;
+
+    const uint32_t submesh_width = host_submesh_shape_.x;
+    const uint32_t submesh_height = host_submesh_shape_.y;
+    const size_t local_device_count = static_cast<size_t>(submesh_width) * submesh_height;
+    devices_.reserve(local_device_count); // Reserve space: local_ points into it
+    if (Debug::should_print(rank_)) {
+         std::cout << "[rank " << rank_ << "] Initializing " << local_device_count << " local devices...\n";
+    }
+    for (uint32_t ly = 0; ly < submesh_height; ++ly) {
+        for (uint32_t lx = 0; lx < submesh_width; ++lx) {
+            uint32_t gx = host_submesh_.x_range.start + lx;
+            uint32_t gy = host_submesh_.y_range.start + ly;
+            // Pass both global and local coordinates to Device constructor
+            devices_.emplace_back(Shape(gx, gy), Shape(lx, ly));
+            local_.add(&devices_.back(), Shape(gx, gy), cq_entries);
+            if (Tracer::on()) {
+                Tracer::name_track(Tracer::kDeviceTrack + uint32_t(local_.size() - 1),
+                                   "device (" + std::to_string(gx) + "," + std::to_string(gy) + ")");
+            }
+        }
+    }
+}
+
+inline void MeshDevice::bring_up_devices(const StartupConfig& startup, bool background) {
+    // Touches only the Devices themselves, so the constructor can carry on meanwhile
+    if (background && Tracer::on()) Tracer::name_thread("bring-up");
+    size_t threads = startup.threads;
+    if (threads == 0) threads = devices_.size();
+    auto task = [&](size_t i) {
+        Device& d = devices_[i];
+        const int64_t begin = Tracer::on() ? Tracer::now() : 0;
+        d.bring_up();
+        if (startup.device_init) startup.device_init(d);
+        if (Tracer::on()) Tracer::record("bring_up", begin, Tracer::now(), Tracer::kDeviceTrack + uint32_t(i));
+    };
+    if (threads <= 1) {
+        for (size_t i = 0; i < devices_.size(); ++i) task(i);
+        return;
+    }
+    DispatchConfig pool;
+    pool.threads = threads - 1; // The calling thread takes part in parallel_for
+    WorkerPool(pool, "bring-up worker").parallel_for(devices_.size(), task);
+}
+
+inline void MeshDevice::configure_dispatch(const DispatchConfig& dispatch) {
+    if (dispatch.threads > 0) {
+        dispatch_pool_.reset(new WorkerPool(dispatch));
+        if (Debug::should_print(rank_)) {
+            std::cout << "[rank " << rank_ << "] dispatch_pending will use " << dispatch.threads 
+                      << " worker thread(s)" << (dispatch.cpus.empty() ? "" : " (pinned)") << "\n";
+        }
     }
 
-    // Set the flag only *after* all initialization and validation is complete
-    first_call_done = true;
+    cq_.programs_.set_capacity(dispatch.program_cache);
+    if (dispatch.async_depth > 0) {
+        cq_.start_async(dispatch.async_depth);
+        if (Debug::should_print(rank_)) {
+            std::cout << "[rank " << rank_ << "] MeshCQ is async, max " << dispatch.async_depth 
+                      << " push(es) in flight\n";
+        }
+    }
 }
 
 inline void MeshDevice::print_host_submesh_layout() {
@@ -391,7 +2647,7 @@ inline void MeshDevice::print_host_submesh_layout() {
     for (uint32_t y = 0; y < hosts_y; ++y) {
         // First line: rank numbers
         for (uint32_t x = 0; x < hosts_x; ++x) {
-            uint32_t rank = y * hosts_x + x;
+            int rank = HostGrid::get().rank_at(Shape(x, y));
             std::cout << "|Rank " << std::setw(2) << rank << "      ";
         }
         std::cout << "|\n";
@@ -419,26 +2675,93 @@ inline void MeshDevice::print_host_submesh_layout() {
 }
 
 inline void MeshDevice::teardown() {
-    MPI_Barrier(MPI_COMM_WORLD); // Ensure all ranks reach teardown
-    static bool once = false;
-    if (!once) { MPI_Finalize(); once = true; }
+    if (closed_) return;
+    cq_.stop_async();            // Drains in-flight pushes
+    Validation::checkpoint("close");
+    dispatch_pool_.reset();      // Join dispatch workers before finalizing
+    HostCoordinator& coord = HostCoordinator::get();
+    if (Tracer::on()) Tracer::write(rank_, world_); // Every recording thread has stopped
+    coord.barrier();             // Ensure all ranks reach teardown
+    coord.finalize();
+    closed_ = true;
+}
+
+inline void MeshDevice::wait(const MeshEvent& ev, bool sync_hosts) {
+    if (!ev.ready() && !cq_.async()) dispatch_pending();
+    ev.wait();
+    if (sync_hosts) sync(ev.scope());
+}
+
+inline void MeshDevice::sync(const DeviceRange& devices) {
+    const std::vector<int>& ranks = HostGrid::get().ranks_of(to_root(devices));
+    if (!std::binary_search(ranks.begin(), ranks.end(), rank_)) return; // Not involved
+    if (ranks.size() == 1) return;                                      // Only this host
+    if (Debug::should_print(rank_)) {
+        std::cout << "[rank " << rank_ << "] sync: barrier over " << ranks.size() << " host(s) of "
+                  << to_string(devices.intersect(DeviceRange::full(mesh_shape_))) << "\n";
+    }
+    Tracer::Span span("sync barrier");
+    span.arg("ranks", ranks.size());
+    HostCoordinator::get().barrier(ranks); // e.g. MPI: sub-communicator cached per rank set
+}
+
+inline void MeshDevice::sync_row() {
+    Tracer::Span span("sync_row barrier");
+    HostCoordinator::get().barrier(HostGrid::get().row());
+}
+inline void MeshDevice::sync_column() {
+    Tracer::Span span("sync_column barrier");
+    HostCoordinator::get().barrier(HostGrid::get().column());
 }
 
 // Original allocate method - now delegates to impl
 inline MeshBuffer MeshDevice::allocate(Shape shape) {
-    return allocate_impl(shape, mesh_shape_); 
+    return allocate_impl(shape, mesh_shape_, BufferSpec()); 
 }
 
 // Overload for allocating with an overridden owning mesh shape - now delegates to impl
 inline MeshBuffer MeshDevice::allocate(Shape buffer_shape, Shape owning_mesh_shape_override) {
-    return allocate_impl(buffer_shape, owning_mesh_shape_override);
+    return allocate_impl(buffer_shape, owning_mesh_shape_override, BufferSpec());
+}
+
+inline MeshBuffer MeshDevice::allocate(Shape buffer_shape, BufferType type) {
+    BufferSpec spec;
+    spec.type = type;
+    return allocate_impl(buffer_shape, mesh_shape_, spec);
+}
+
+inline MeshBuffer MeshDevice::allocate(Shape buffer_shape, const BufferSpec& spec) {
+    return allocate_impl(buffer_shape, mesh_shape_, spec);
 }
 
 // Implementation of the private helper
-inline MeshBuffer MeshDevice::allocate_impl(Shape buffer_shape, Shape owning_mesh_shape) {
-    // Use a single static epoch counter for both allocation paths
-    static uint64_t epoch = 0; 
-    uint64_t base = (0x9e3779b97f4a7c15ULL * ++epoch) & 0x7fffffffffffULL;
+inline MeshBuffer MeshDevice::allocate_impl(Shape buffer_shape, Shape owning_mesh_shape, const BufferSpec& spec) {
+    Tracer::Span span("allocate");
+    const BufferType type = spec.type;
+    BankAllocator& alloc = mutable_allocator(type);
+    // Every device holds one shard (or the full extent along replicated axes)
+    MeshBuffer buf(0, buffer_shape, owning_mesh_shape, spec, DeviceRange(host_submesh_.x_range, host_submesh_.y_range));
+    if (spec.layout == HostLayout::TILE &&
+        (buffer_shape.x % spec.tile.w || buffer_shape.y % spec.tile.h || buf.shard_shape().x % spec.tile.w ||
+         buf.shard_shape().y % spec.tile.h || spec.tile.w % spec.tile.face_w || spec.tile.h % spec.tile.face_h)) {
+        if (rank_ == 0) {
+            std::cerr << "Error: tilized MeshBuffer shape=" << to_string(buffer_shape) << " needs whole "
+                      << spec.tile.w << "x" << spec.tile.h << " tiles per device shard (shard "
+                      << to_string(buf.shard_shape()) << "); allocate it padded\n";
+        }
+        HostCoordinator::get().abort(1);
+    }
+    uint64_t bytes = buf.device_bytes();
+    uint64_t base = 0;
+    if (!alloc.allocate(bytes, base)) {
+        // Identical on every rank (deterministic allocator), so report once
+        if (rank_ == 0) {
+            std::cerr << "Error: out of " << to_string(type) << " allocating MeshBuffer shape=" << to_string(buffer_shape)
+                      << " (" << alloc.bank_footprint(bytes) << " bytes/bank, largest free block "
+                      << alloc.largest_free() << ")\n";
+        }
+        HostCoordinator::get().abort(1);
+    }
 
     // Print allocation message if debug enabled for this rank, using the provided owning shape
     if (Debug::should_print(rank_)) {
@@ -446,99 +2769,602 @@ inline MeshBuffer MeshDevice::allocate_impl(Shape buffer_shape, Shape owning_mes
         bool is_override = !(owning_mesh_shape.x == mesh_shape_.x && owning_mesh_shape.y == mesh_shape_.y);
         std::cout << "[rank " << rank_ << "] Allocating MeshBuffer shape=" << to_string(buffer_shape) 
                   << (is_override ? " with OVERRIDDEN Owning MeshDevice shape=" : " for MeshDevice shape=")
-                  << to_string(owning_mesh_shape) << "\n";
+                  << to_string(owning_mesh_shape) << " in " << to_string(type) << " @0x" << std::hex << base << std::dec
+                  << " (" << alloc.bank_footprint(bytes) << " bytes x " << alloc.config().num_banks << " banks)\n";
     }
 
     if (Validation::on()) {
         // Validation still checks consistency of buffer_shape and base across ranks
-        uint64_t crc = base ^ buffer_shape.x ^ buffer_shape.y;
-        uint64_t x;
-        MPI_Allreduce(&crc, &x, 1, MPI_UINT64_T, MPI_BXOR, MPI_COMM_WORLD);
-        assert(x == 0 && "ranks diverged during allocation");
+        uint64_t layout = uint64_t(type) | uint64_t(spec.dtype) << 8 | uint64_t(spec.x) << 16 | uint64_t(spec.y) << 24 |
+                          uint64_t(spec.layout) << 32 | uint64_t(spec.tile.h) << 40 | uint64_t(spec.tile.w) << 52;
+        uint64_t crc = mix64(base ^ mix64(layout)) ^ buffer_shape.x ^ (uint64_t(buffer_shape.y) << 32);
+        Validation::check(crc, "MeshBuffer allocation");
         // Print validation success message if debug enabled for this rank
-        if (Debug::should_print(rank_)) { 
+        if (Validation::blocking() && Debug::should_print(rank_)) { 
             std::cout << "[rank " << rank_ << "] Validation: MeshBuffer allocation OK\n"; 
         }
     }
-    // Pass the effective owning shape to the constructor
-    return MeshBuffer(base, buffer_shape, owning_mesh_shape); 
+    buf.base_ = base;
+    return buf; 
+}
+
+inline void MeshDevice::deallocate(MeshBuffer& buf) {
+    assert(buf.allocated_ && "MeshBuffer deallocated twice");
+    if (!buf.allocated_) return;
+    mutable_allocator(buf.spec_.type).deallocate(buf.base_);
+    buf.allocated_ = false;
+
+    if (Debug::should_print(rank_)) {
+        std::cout << "[rank " << rank_ << "] Deallocating MeshBuffer shape=" << to_string(buf.shape_) 
+                  << " in " << to_string(buf.spec_.type) << " @0x" << std::hex << buf.base_ << std::dec << "\n";
+    }
+    if (Validation::on()) {
+        uint64_t crc = mix64(~buf.base_ ^ (uint64_t(buf.spec_.type) << 62));
+        Validation::check(crc, "MeshBuffer deallocation");
+    }
 }
 
 inline HostBuffer MeshBuffer::host_view() const {
-    /* equally divide bytes across ranks */
-    int world;
-    MPI_Comm_size(MPI_COMM_WORLD, &world);
-    return HostBuffer(bytes() / world);
+    /* only this rank's shard(s): sharded axes divide by the host count along that axis */
+    HostBuffer host(host_region_, spec_.dtype);
+    host.layout_ = spec_.layout;
+    host.tile_ = spec_.tile;
+    return host;
+}
+
+inline MeshEvent MeshCQ::push(const MeshWorkload& wl) {
+    return push(&wl, 1);
+}
+
+inline MeshEvent MeshCQ::push(const MeshWorkload* wls, size_t count) {
+    Tracer::Span span("push");
+    span.arg("workloads", count);
+    DeviceRange scope;
+    bool any = false;
+    for (size_t i = 0; i < count; ++i) {
+        const MeshWorkload& wl = wls[i];
+        if (wl.words().empty()) continue;
+        any = true;
+        track_check(wl.pending_check());
+        if (wl.args_dirty_ && Validation::on()) {
+            // Arguments changed by set_arg since the last push: they are lockstep state too
+            wl.args_dirty_ = false;
+            lockstep(wl.args_hash(), "MeshWorkload arguments", dev_.group_of(wl.footprint()));
+        }
+        scope = scope.bounding(wl.footprint());
+    }
+    if (!any) return MeshEvent();
+    if (tracing_) trace_scope_ = trace_scope_.bounding(scope);
+    // submit runs the enqueue on this thread in both modes, so `wls` is only read here
+    return submit([this, wls, count] { enqueue_local(wls, count); }, false, scope);
+}
+
+inline void MeshCQ::lockstep(uint64_t op_hash, const char* what, const std::vector<int>* group) {
+    if (!Validation::on()) return;
+    if (Validation::mode() == Validation::Mode::NONBLOCKING) {
+        track_check(Validation::post(op_hash, what, group));
+        return;
+    }
+    Validation::check(op_hash, what, group);
+}
+
+inline void MeshCQ::track_check(const Validation::CheckHandle& c) {
+    if (!c) return;
+    if (!async()) { pending_checks_.push_back(c); return; }
+    // MPI stays on the host thread: settle the nonblocking check before the dispatch
+    // thread can see the op (it overlapped with everything since it was posted)
+    Validation::complete(c, "MeshCQ::push");
+}
+
+inline void MeshCQ::begin_trace() {
+    assert(!tracing_ && "MeshCQ::begin_trace while already capturing");
+    tracing_ = true;
+    trace_scope_ = DeviceRange();
+    lockstep(mix64(0x7472616365ULL ^ next_trace_id_), "MeshCQ::begin_trace");
+    submit([this] {
+        capture_.assign(dev_.local_.size(), std::vector<CmdSegment>());
+        capturing_ = true;
+    }, false);
+}
+
+inline uint32_t MeshCQ::end_trace() {
+    assert(tracing_ && "MeshCQ::end_trace without begin_trace");
+    tracing_ = false;
+    const uint32_t id = next_trace_id_++;
+    trace_scopes_[id] = trace_scope_;
+    lockstep(mix64(~0x7472616365ULL ^ id), "MeshCQ::end_trace");
+    submit([this, id] {
+        // One stream per local device; in a real implementation: written once into a
+        // reserved device DRAM region here, so replay only issues an "execute trace" command
+        Trace& t = traces_[id];
+        size_t words = 0;
+        for (size_t d = 0; d < capture_.size(); ++d) {
+            if (capture_[d].empty()) continue;
+            std::shared_ptr<std::vector<uint64_t> > stream = std::make_shared<std::vector<uint64_t> >();
+            for (const auto& seg : capture_[d]) stream->insert(stream->end(), seg.begin(), seg.end());
+            words += stream->size();
+            t.push_back(std::make_pair(d, CmdSegment(stream)));
+        }
+        capture_.clear();
+        capturing_ = false;
+        if (Debug::should_print(dev_.rank())) {
+            std::cout << "[rank " << dev_.rank() << "] MeshCQ::end_trace: trace " << id << " holds " << words
+                      << " word(s) for " << t.size() << " local Device(s)\n";
+        }
+    }, false);
+    return id;
+}
+
+inline MeshEvent MeshCQ::replay_trace(uint32_t id, bool blocking) {
+    Tracer::Span span("replay_trace");
+    span.arg("trace", id);
+    assert(!tracing_ && "MeshCQ::replay_trace while capturing");
+    lockstep(mix64(0x7265706c6179ULL ^ id), "MeshCQ::replay_trace"); // No-op unless validating
+    auto scope = trace_scopes_.find(id);
+    return submit([this, id] {
+        auto it = traces_.find(id);
+        assert(it != traces_.end() && "MeshCQ::replay_trace of an unknown trace");
+        if (it == traces_.end()) return;
+        for (const auto& e : it->second) put(e.first, e.second);
+        if (Debug::should_print(dev_.rank())) {
+            std::cout << "[rank " << dev_.rank() << "] MeshCQ::replay_trace: trace " << id << " on "
+                      << it->second.size() << " local Device(s)\n";
+        }
+    }, blocking, scope != trace_scopes_.end() ? scope->second : DeviceRange());
+}
+
+inline void MeshCQ::release_trace(uint32_t id) {
+    trace_scopes_.erase(id);
+    submit([this, id] { traces_.erase(id); }, false);
+}
+
+inline MeshEvent MeshCQ::enqueue_write(const MeshBuffer& buf, const HostBuffer& host, bool blocking) {
+    assert(buf.dtype() == host.dtype() && "HostBuffer element type does not match MeshBuffer");
+    assert(same_layout(buf, host) && "HostBuffer layout does not match the MeshBuffer's (see BufferSpec::layout)");
+    uint8_t* data = static_cast<uint8_t*>(const_cast<void*>(host.ptr()));
+    TensorRegion region = host.region();
+    size_t es = element_size(host.dtype());
+    return submit([this, buf, data, region, es] {
+        enqueue_transfer(Transfer::Dir::WRITE, buf, data, region, es);
+    }, blocking, DeviceRange::full(dev_.mesh_shape()));
+}
+
+inline MeshEvent MeshCQ::enqueue_read(const MeshBuffer& buf, HostBuffer& host, bool blocking) {
+    assert(buf.dtype() == host.dtype() && "HostBuffer element type does not match MeshBuffer");
+    assert(same_layout(buf, host) && "HostBuffer layout does not match the MeshBuffer's (see BufferSpec::layout)");
+    uint8_t* data = static_cast<uint8_t*>(host.ptr());
+    TensorRegion region = host.region();
+    size_t es = element_size(host.dtype());
+    return submit([this, buf, data, region, es] {
+        enqueue_transfer(Transfer::Dir::READ, buf, data, region, es);
+    }, blocking, DeviceRange::full(dev_.mesh_shape()));
+}
+
+inline MeshEvent MeshCQ::enqueue_write(const MeshBuffer& buf, const void* src, const TensorRegion& region,
+                                       size_t row_pitch, bool blocking) {
+    assert(buf.spec().layout == HostLayout::ROW_MAJOR && "row-major source for a tilized MeshBuffer");
+    uint8_t* data = static_cast<uint8_t*>(const_cast<void*>(src));
+    size_t es = element_size(buf.dtype());
+    return submit([this, buf, data, region, es, row_pitch] {
+        enqueue_transfer(Transfer::Dir::WRITE, buf, data, region, es, row_pitch);
+    }, blocking, DeviceRange::full(dev_.mesh_shape()));
+}
+
+inline MeshEvent MeshCQ::submit(const std::function<void()>& enqueue, bool blocking, const DeviceRange& scope) {
+    MeshEvent ev;
+    if (!async()) {
+        enqueue();
+        ev = MeshEvent(++next_event_id_);
+        ev.state_->scope = scope;
+        pending_events_.push_back(ev);
+        if (blocking) dev_.dispatch_pending();
+        return ev;
+    }
+
+    std::unique_lock<std::mutex> lock(mu_);
+    space_cv_.wait(lock, [this] { return in_flight_ < depth_; }); // Backpressure
+    lock.unlock();
+    enqueue(); // Straight into the rings, while the dispatch thread may be draining them
+    lock.lock();
+    ev = MeshEvent(++next_event_id_);
+    ev.state_->scope = scope;
+    queue_.push_back(ev);
+    ++in_flight_;
+    lock.unlock();
+    work_cv_.notify_one();
+    if (blocking) ev.wait();
+    return ev;
+}
+
+inline void MeshCQ::enqueue_transfer(Transfer::Dir dir, const MeshBuffer& buf, uint8_t* host,
+                                     const TensorRegion& hr, size_t es, size_t host_pitch) {
+    // A tilized buffer is a row-major grid of tiles: one "row" is a row of tiles and one
+    // "element" a whole tile, so the same strided copy applies in tile units.
+    const TileShape* tile = buf.spec().layout == HostLayout::TILE ? &buf.spec().tile : nullptr;
+    const uint32_t th = tile ? tile->h : 1, tw = tile ? tile->w : 1;
+    const size_t unit = tile ? tile->elements() * es : es;
+    assert(!capturing_ && "host<->device transfers cannot be captured in a trace");
+    const uint64_t key = (uint64_t(buf.type()) << 63) | buf.address();
+    const Shape shard_shape = buf.shard_shape();
+    std::vector<TensorRegion> read_from; // Regions already covered by a read (replicated axes)
+    size_t transfers = 0, bytes = 0;
+    Tracer::Span span(dir == Transfer::Dir::WRITE ? "enqueue_write" : "enqueue_read");
+
+    const std::vector<Shape>& coords = dev_.local_.coords;
+    for (size_t device = 0; device < coords.size(); ++device) {
+        TensorRegion shard = buf.region_of(DeviceRange::device(coords[device]));
+        TensorRegion part = { shard.x_range.intersect(hr.x_range), shard.y_range.intersect(hr.y_range) };
+        if (part.empty()) continue;
+        if (dir == Transfer::Dir::READ) {
+            bool covered = false;
+            for (const auto& r : read_from) {
+                covered = covered || (r.x_range.start == part.x_range.start && r.x_range.end == part.x_range.end &&
+                                      r.y_range.start == part.y_range.start && r.y_range.end == part.y_range.end);
+            }
+            if (covered) continue;
+            read_from.push_back(part);
+        }
+
+        assert((!tile || (shard_shape.x % tw == 0 && shard_shape.y % th == 0 &&
+                          (part.x_range.start - hr.x_range.start) % tw == 0 &&
+                          (part.y_range.start - hr.y_range.start) % th == 0)) &&
+               "tilized transfer needs tile-aligned device shards");
+
+        Transfer t;
+        t.dir           = dir;
+        t.host_pitch    = host_pitch ? host_pitch : hr.width() / tw * unit;
+        t.host          = host + (part.y_range.start - hr.y_range.start) / th * t.host_pitch
+                               + (part.x_range.start - hr.x_range.start) / tw * unit;
+        t.device_key    = key;
+        t.device_bytes  = buf.device_bytes();
+        t.device_pitch  = shard_shape.x / tw * unit;
+        t.device_offset = (part.y_range.start - shard.y_range.start) / th * t.device_pitch
+                        + (part.x_range.start - shard.x_range.start) / tw * unit;
+        t.row_bytes     = part.width() / tw * unit;
+        t.rows          = part.height() / th;
+        put(device, t);
+        ++transfers;
+        bytes += t.bytes();
+    }
+    span.arg("bytes", bytes);
+
+    if (Debug::should_print(dev_.rank())) {
+        std::cout << "[rank " << dev_.rank() << "] MeshCQ::enqueue_" << (dir == Transfer::Dir::WRITE ? "write" : "read")
+                  << ": " << bytes << " byte(s) in " << transfers << " per-device transfer(s)\n";
+    }
+}
+
+inline void MeshCQ::complete_checks() {
+    for (const auto& c : pending_checks_) Validation::complete(c, "dispatch_pending");
+    pending_checks_.clear();
+}
+
+inline void MeshCQ::complete_pending() {
+    for (const auto& ev : pending_events_) ev.complete();
+    pending_events_.clear();
+}
+
+inline void MeshCQ::finish() {
+    Tracer::Span span("finish");
+    if (!async()) {
+        if (!pending_events_.empty()) dev_.dispatch_pending();
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mu_);
+    idle_cv_.wait(lock, [this] { return in_flight_ == 0; });
+}
+
+inline void MeshCQ::start_async(size_t depth) {
+    assert(!async() && depth > 0);
+    finish(); // Nothing may be left in the synchronous path
+    depth_ = depth;
+    stop_ = false;
+    worker_ = std::thread(&MeshCQ::async_loop, this);
+}
+
+inline void MeshCQ::stop_async() {
+    if (!async()) return;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    worker_.join(); // The loop drains the queue before exiting
+}
+
+template <typename... T> inline void MeshCQ::put(size_t device, const T&... item) {
+    while (!dev_.local_.queues[device].try_enqueue(item...)) make_room(device);
+}
+
+inline void MeshCQ::make_room(size_t device) {
+    if (!async()) {
+        // Nothing else drains a sync MeshCQ: dispatch this device now (validation first)
+        complete_checks();
+        dev_.dispatch_device(device);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        drain_ = true;
+    }
+    work_cv_.notify_one();
+    std::this_thread::yield();
+}
+
+inline void MeshCQ::async_loop() {
+    if (Tracer::on()) Tracer::name_thread(dev_.is_submesh() ? "MeshCQ dispatch (submesh)" : "MeshCQ dispatch");
+    std::vector<MeshEvent> batch;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mu_);
+            work_cv_.wait(lock, [this] { return stop_ || drain_ || !queue_.empty(); });
+            if (queue_.empty() && !drain_) return; // stop_ and drained
+            // Take everything queued so far: one dispatch pass per batch of pushes
+            drain_ = false;
+            batch.assign(queue_.begin(), queue_.end());
+            queue_.clear();
+        }
+
+        // Entries of these events were published before them; later ones may come along
+        {
+            Tracer::Span span("dispatch");
+            span.arg("events", batch.size());
+            dev_.dispatch_local();
+        }
+        for (const auto& ev : batch) ev.complete();
+
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            in_flight_ -= batch.size();
+            if (in_flight_ == 0) idle_cv_.notify_all();
+        }
+        space_cv_.notify_all();
+        batch.clear();
+    }
+}
+
+inline Program MeshCQ::encode(const MeshWorkload& wl) const {
+    // Only commands whose device target intersects this host's submesh are encoded;
+    // a host outside every run's target gets an empty Program.
+    const HostSubmesh& host = dev_.host_submesh_;
+    const DeviceRange host_range(host.x_range, host.y_range);
+    const std::vector<MeshWorkload::CmdRun>& runs = wl.runs();
+    const std::vector<uint64_t>& words = wl.words();
+    const std::vector<MeshWorkload::ArgSlot>& args = wl.args();
+    std::vector<std::vector<uint32_t> > device_runs(dev_.local_.size()); // Run indices, in order
+    std::vector<size_t> fabric(dev_.local_.size(), 0);
+    Program p;
+
+    for (size_t r = 0; r < runs.size(); ++r) {
+        const MeshWorkload::CmdRun& run = runs[r];
+        DeviceRange local = run.target.intersect(host_range);
+        if (local.empty()) { ++p.skipped_runs; continue; }
+        // Multicast heads: the first device of each local row, or of each column if the
+        // part is taller than wide. Every other device is reached over the fabric; it has
+        // the same run list as its head, so both hold one shared binary, told apart only
+        // by fabric_words.
+        const bool by_column = local.x_range.size() < local.y_range.size();
+        for (uint32_t gy = local.y_range.start; gy < local.y_range.end; ++gy) {
+            size_t row = dev_.local_index(Shape(local.x_range.start, gy));
+            for (uint32_t gx = local.x_range.start; gx < local.x_range.end; ++gx) {
+                size_t d = row + (gx - local.x_range.start);
+                device_runs[d].push_back(uint32_t(r));
+                const bool head = by_column ? gy == local.y_range.start : gx == local.x_range.start;
+                if (run.multicast && !head) fabric[d] += run.count;
+            }
+        }
+    }
+
+    std::map<std::vector<uint32_t>, size_t> binary_of; // Run list -> index in p.binaries
+    for (size_t d = 0; d < device_runs.size(); ++d) {
+        const std::vector<uint32_t>& list = device_runs[d];
+        if (list.empty()) continue;
+        auto it = binary_of.find(list);
+        if (it == binary_of.end()) {
+            it = binary_of.insert(std::make_pair(list, p.binaries.size())).first;
+            p.binaries.push_back(Program::Binary());
+            Program::Binary& b = p.binaries.back();
+            size_t arg = 0, total = 0;
+            for (uint32_t r : list) total += runs[r].count;
+            for (uint32_t r : list) {
+                const MeshWorkload::CmdRun& run = runs[r];
+                while (arg < args.size() && args[arg].offset < run.offset) ++arg;
+                for (size_t a = arg; a < args.size() && args[a].offset < run.offset + run.count; ++a) {
+                    size_t base = b.words ? b.words->size() : 0;
+                    b.args.push_back(std::make_pair(a, base + args[a].offset - run.offset));
+                }
+                if (list.size() == 1 && b.args.empty()) { b.view = wl.segment(run); break; } // No copy
+                if (!b.words) {
+                    b.words = std::make_shared<std::vector<uint64_t> >();
+                    b.words->reserve(total);
+                }
+                b.words->insert(b.words->end(), words.begin() + run.offset, words.begin() + run.offset + run.count);
+            }
+        }
+        Program::Binary& b = p.binaries[it->second];
+        b.devices.push_back(d);
+        b.fabric_words.push_back(fabric[d]);
+    }
+    return p;
 }
 
-inline void MeshCQ::push(const MeshWorkload& wl) {
-    const auto& words = wl.words();
-    if (words.empty()) return;
+inline void MeshCQ::enqueue_local(const MeshWorkload* wls, size_t count) {
+    parts_.resize(dev_.local_.size());
+    parts_fabric_.resize(dev_.local_.size());
+    size_t words = 0, runs = 0, enqueued_words = 0, fabric = 0, patched = 0, skipped = 0, hits = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const MeshWorkload& wl = wls[i];
+        if (wl.words().empty()) continue;
+        Program* p = programs_.find(wl.structure());
+        if (p) ++hits;
+        else p = &programs_.insert(wl.structure(), encode(wl));
+
+        const std::vector<MeshWorkload::ArgSlot>& args = wl.args();
+        for (auto& b : p->binaries) {
+            // Patch runtime arguments; copy first if a DeviceCQ (or this batch) still holds
+            // this binary. One copy per binary, however many devices share it.
+            bool stale = false;
+            for (const auto& a : b.args) stale = stale || (*b.words)[a.second] != args[a.first].value;
+            if (stale) {
+                if (b.words.use_count() > 1) b.words = std::make_shared<std::vector<uint64_t> >(*b.words);
+                else std::atomic_thread_fence(std::memory_order_acquire); // Dispatch thread is done with it
+                for (const auto& a : b.args) (*b.words)[a.second] = args[a.first].value;
+                ++patched;
+            }
+            // The handle keeps these words alive (and unpatched) past a cache eviction
+            const CmdSegment seg = b.segment();
+            for (size_t k = 0; k < b.devices.size(); ++k) {
+                parts_[b.devices[k]].push_back(seg);
+                parts_fabric_[b.devices[k]] += b.fabric_words[k];
+            }
+        }
+        words += wl.words().size();
+        runs += wl.runs().size();
+        skipped += p->skipped_runs;
+    }
+
+    size_t devices = 0;
+    std::map<std::vector<const uint64_t*>, CmdSegment> joined_for; // Batch: devices with the same binaries share the join
+    for (size_t d = 0; d < parts_.size(); ++d) {
+        std::vector<CmdSegment>& parts = parts_[d];
+        if (parts.empty()) continue;
+        // One handle per device: its whole binary for a single workload (no copy),
+        // otherwise the batch's binaries concatenated into one segment
+        CmdSegment seg = parts[0];
+        if (parts.size() > 1) {
+            std::vector<const uint64_t*> key;
+            key.reserve(parts.size());
+            for (const auto& part : parts) key.push_back(part.data());
+            CmdSegment& join = joined_for[key];
+            if (join.empty()) {
+                size_t n = 0;
+                for (const auto& part : parts) n += part.size();
+                std::shared_ptr<std::vector<uint64_t> > joined = std::make_shared<std::vector<uint64_t> >();
+                joined->reserve(n);
+                for (const auto& part : parts) joined->insert(joined->end(), part.begin(), part.end());
+                join = CmdSegment(joined);
+            }
+            seg = join;
+        }
+        parts.clear();
+        put(d, seg, parts_fabric_[d]);
+        if (capturing_) capture_[d].push_back(seg); // Handle keeps these words from being patched
+        enqueued_words += seg.size();
+        fabric += parts_fabric_[d];
+        parts_fabric_[d] = 0;
+        ++devices;
+    }
+    host_words_ += enqueued_words - fabric;
+    fabric_words_ += fabric;
 
-    // Dispatch commands to all local Devices owned by the associated MeshDevice.
-    size_t local_device_count = dev_.local_devices_.size(); // Access via friend
     if (Debug::should_print(dev_.rank())) {
-        std::cout << "[rank " << dev_.rank() << "] MeshCQ::push: Dispatching " << words.size() 
-                  << " command(s) to " << local_device_count << " local Devices\n";
+        std::ostringstream msg;
+        msg << "[rank " << dev_.rank() << "] MeshCQ::push: Dispatching " << words
+            << " command(s) in " << runs << " run(s)";
+        if (count > 1) msg << " from " << count << " workload(s)";
+        msg << ": " << enqueued_words << " word(s) enqueued to " << devices << " local Device(s)";
+        if (fabric) msg << " (" << fabric << " via fabric multicast)";
+        msg << ", "
+            << skipped << " run(s) not targeting this host (program cache ";
+        if (count > 1) msg << hits << "/" << count << " hit(s)";
+        else           msg << (hits ? "hit" : "miss");
+        msg << ", " << patched << " binary(ies) patched)\n";
+        std::cout << msg.str();
+    }
+}
+
+inline void MeshDevice::dispatch_device(size_t i) {
+    DeviceCQ& d_cq = local_.queues[i];
+    Device& device = *local_.devices[i];
+    if (d_cq.empty()) return;
+
+    // Drains what the producer has published so far; it may keep enqueueing meanwhile
+    const bool traced = Tracer::on();
+    const int64_t begin = traced ? Tracer::now() : 0;
+    size_t words = 0, fabric = 0, transfers = 0;
+    size_t entries = d_cq.drain([&](const DeviceCQ::Entry& e) {
+        if (e.is_transfer()) { device.execute(*e.xfer); ++transfers; }
+        else { words += e.cmds.size(); fabric += e.fabric_words; }
+        // In a real implementation: Send each command segment to the specific hardware
+        // device, except its fabric words: the device waits here for its multicast head
+    });
+    if (traced) {
+        // The physical device's track, whichever MeshDevice view dispatched it
+        const uint32_t track = Tracer::kDeviceTrack + device.local_coords.y * root_->host_submesh_.shape.x + device.local_coords.x;
+        Tracer::record("dispatch", begin, Tracer::now(), track, "commands", words, "transfers", transfers);
     }
 
-    for (size_t i = 0; i < local_device_count; ++i) {
-        // Access the cq_ member of the Device via friend access
-        dev_.local_devices_[i].cq_.cmds_.insert(
-            dev_.local_devices_[i].cq_.cmds_.end(),
-            words.begin(),
-            words.end()
-        );
+    if (Debug::should_print(rank_)) {
+        std::ostringstream msg;
+        msg << "[rank " << rank_ 
+            << "]   Dispatched for Device @ global (" << device.global_coords.x << "," << device.global_coords.y 
+            << ") / local (" << device.local_coords.x << "," << device.local_coords.y
+            << "): " << words << " command(s) in " 
+            << (entries - transfers) << " segment(s)";
+        if (fabric) msg << " (" << fabric << " via fabric multicast)";
+        msg << ", " << transfers << " transfer(s)\n";
+        std::lock_guard<std::mutex> lock(print_mu_);
+        std::cout << msg.str();
     }
 }
 
 inline void MeshDevice::dispatch_pending() {
+    // Async MeshCQ owns the DeviceCQs; its dispatch thread is already draining them
+    if (cq_.async()) return;
+    Tracer::Span span("dispatch_pending");
+    cq_.complete_checks(); // Aborts on divergence before anything reaches a device
+    dispatch_local();
+    cq_.complete_pending();
+}
+
+inline void MeshDevice::dispatch_local() {
     // Iterate through local Devices and process/print their commands
     if (Debug::should_print(rank_)) {
         std::cout << "[rank " << rank_ << "] dispatch_pending: Processing local Devices...\n";
     }
-    size_t local_device_count = local_devices_.size();
-
-    for (size_t i = 0; i < local_device_count; ++i) {
-        Device& device = local_devices_[i]; 
-        DeviceCQ& d_cq = device.cq_;      
-
-        if (!d_cq.cmds_.empty()) {
-            uint32_t global_x = device.global_coords.x;
-            uint32_t global_y = device.global_coords.y;
-            uint32_t local_x = device.local_coords.x;
-            uint32_t local_y = device.local_coords.y;
-            
-            if (Debug::should_print(rank_)) {
-                std::cout << "[rank " << rank_ 
-                          << "]   Dispatching for Device @ global (" << global_x << "," << global_y 
-                          << ") / local (" << local_x << "," << local_y
-                          << "): " << d_cq.cmds_.size() << " command(s)\n";
-            }
-            // In a real implementation: Send commands from d_cq.cmds_ to the specific hardware device
-            
-            // Clear the queue after dispatching
-            d_cq.cmds_.clear();
+
+    if (!dispatch_pool_) {
+        for (size_t i = 0; i < local_.size(); ++i) dispatch_device(i);
+    } else {
+        // Longest queues first, so the tail of the run is made of short queues that
+        // idle workers can pick up while the long ones finish.
+        std::vector<size_t> order;
+        order.reserve(local_.size());
+        for (size_t i = 0; i < local_.size(); ++i) {
+            if (!local_.queues[i].empty()) order.push_back(i);
         }
+        std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+            return local_.queues[a].size() > local_.queues[b].size();
+        });
+        dispatch_pool_->parallel_for(order.size(), [&](size_t i) {
+            dispatch_device(order[i]);
+        });
     }
+
     if (Debug::should_print(rank_)) {
         std::cout << "[rank " << rank_ << "] dispatch_pending: Finished processing local Devices.\n";
     }
 }
 
 inline void MeshDevice::wait() {
+    Tracer::Span span("wait");
+    cq_.finish(); // Local completion of every push before the cross-host sync
+    Stragglers::arrive(); // End of this rank's step, before any collective evens the ranks out
+    Validation::checkpoint("wait");
     // Print message before barrier if debug enabled for this rank
     if (Debug::should_print(rank_)) {
-        std::cout << "[rank " << rank_ << "] Entering wait (MPI_Barrier)\n";
+        std::cout << "[rank " << rank_ << "] Entering wait (" << HostCoordinator::get().name() << " barrier)\n";
+    }
+    {
+        Tracer::Span barrier("barrier"); // Its length on each rank shows that rank's arrival skew
+        if (!Stragglers::reduce()) HostCoordinator::get().barrier(); // The reduction synchronizes too
     }
-    MPI_Barrier(MPI_COMM_WORLD);
+    Stragglers::depart();
     // Print message after barrier if debug enabled for this rank
     if (Debug::should_print(rank_)) {
-         std::cout << "[rank " << rank_ << "] Exiting wait (MPI_Barrier complete)\n"; // Changed message
+         std::cout << "[rank " << rank_ << "] Exiting wait (barrier complete)\n";
     }
 }
 
-// Define the static member
-bool MeshDevice::first_call_done = false;
 
 }  // namespace mesh